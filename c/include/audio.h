@@ -0,0 +1,46 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdatomic.h>
+
+#include "typedefs.h"
+
+#define AUDIO_RATE 48000  // samples per second, mono s16
+#define AUDIO_RING 4096   // ring size in samples, a power of two
+#define AUDIO_QUEUE 1600  // most samples queued before the producer drops
+#define AUDIO_TONE 440    // buzzer pitch in Hz
+#define AUDIO_VOLUME 3000 // square wave amplitude
+#define PATTERN_RATE 4000 // xo-chip pattern bits per second at pitch 64
+
+// buzzer samples from the emulation thread to the audio callback. one
+// producer (audio_frame), one consumer (audio_pull), no locks: each side
+// only writes its own index. neither side ever waits, a full ring drops
+// new samples and an empty one plays silence
+typedef struct Audio {
+  int16_t ring[AUDIO_RING];
+  _Alignas(64) atomic_uint head; // next sample to play, consumer owned
+  _Alignas(64) atomic_uint tail; // next free slot, producer owned
+  // producer side
+  uint32_t phase;    // 16.16 position in the square wave period
+  uint32_t step;     // phase advance per sample
+  uint32_t bit;      // 16.16 position in the xo-chip pattern
+  uint32_t carry;    // fractional samples owed between frames
+  uint64_t produced; // samples queued
+  uint64_t dropped;  // samples that did not fit (overrun)
+  uint64_t overruns; // frames that lost samples
+  // consumer side, read once the callback has stopped
+  uint64_t played;     // samples handed to the device
+  uint64_t starved;    // silence played because the ring was empty
+  uint64_t underruns;  // times it ran dry in the middle of a tone
+  uint64_t pulls;      // callbacks
+  uint64_t queued_sum; // samples waiting at each callback, for the mean
+  uint32_t queued_max;
+  int16_t last; // last sample played, tells a cut tone from silence
+} audio_t;
+
+void init_audio(audio_t *a);
+void audio_frame(audio_t *a, bool beep, const chip8_t *c8);
+void audio_pull(audio_t *a, int16_t *out, uint32_t n);
+void print_audio_stats(const audio_t *a);
+
+#endif
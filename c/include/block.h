@@ -0,0 +1,32 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include "ops.h"
+
+#define BLOCK_MAX 32 // longest straight line run decoded at once
+
+// a straight line run of decoded instructions starting at pc. ends at (and
+// includes) the first op that branches or writes ram
+typedef struct Block {
+  bool valid;
+  uint8_t len;
+  uint64_t pages; // ram pages the block was decoded from
+  op_fn fn[BLOCK_MAX];
+  uint16_t op[BLOCK_MAX];
+} block_t;
+
+// decoded blocks keyed by pc, allocated the first time a pc is entered
+typedef struct BlockCache {
+  block_t *blocks[CODE_SIZE];
+  uint64_t code_pages; // pages that have a valid block decoded from them
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t invalidations; // blocks thrown away because their ram changed
+} block_cache_t;
+
+block_cache_t *new_block_cache(void);
+void free_block_cache(block_cache_t *bc);
+void invalidate_blocks(block_cache_t *bc, uint64_t pages);
+uint32_t block_run(block_cache_t *bc, chip8_t *c8, config_t config, uint32_t n);
+
+#endif
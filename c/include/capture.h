@@ -0,0 +1,67 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "framebuffer.h"
+
+#define CAPTURE_SLOTS 256 // frames queued for the writer, a power of two
+#define CAPTURE_PNG_DATA                                                       \
+  (DISPLAY_HEIGHT * (DISPLAY_WIDTH + 1)) // filter byte + indices per row
+
+// one finished frame as the emulation thread left it
+typedef struct CaptureSlot {
+  row_t display[2][64];
+  bool hires;
+  uint64_t seq; // frame number, counting dropped ones
+} capture_slot_t;
+
+// frames from the emulation thread to a writer thread that encodes them.
+// one producer (capture_frame), one consumer, the slots are allocated up
+// front and the indices work like the audio ring. when the writer falls
+// behind, new frames are dropped or the producer waits for a free slot,
+// whichever --capture-drop/--capture-block said. every frame comes out
+// 128x64, lores pixels doubled, so a mode switch keeps the size
+typedef struct Capture {
+  capture_slot_t *slots;         // CAPTURE_SLOTS
+  _Alignas(64) atomic_uint head; // next frame to write, writer owned
+  _Alignas(64) atomic_uint tail; // next free slot, producer owned
+  atomic_bool done;              // no frames after the queued ones
+  sem_t wake;                    // posted with every frame
+  sem_t room;                    // posted with every frame written, block
+  pthread_t thread;
+  FILE *out;
+  const char *path;
+  capture_format_t format;
+  bool block;            // wait for a slot instead of dropping the frame
+  uint8_t palette[4][3]; // RGB by colour index
+  // producer side
+  uint64_t seq;      // frames offered
+  uint64_t dropped;  // frames that found the queue full
+  uint64_t stalls;   // times the producer waited for a slot
+  uint64_t stall_ns; // spent waiting for a slot
+  uint64_t copy_ns;  // spent in capture_frame() otherwise
+  // writer side, read once the writer stopped
+  uint8_t image[DISPLAY_HEIGHT][DISPLAY_WIDTH]; // last frame, colour index
+  uint64_t image_seq;
+  bool holding;     // image waits for the next frame to know its length
+  uint64_t written; // frames encoded, repeats in a y4m included
+  uint32_t png_seq; // apng fcTL/fdAT sequence number
+  long actl;        // where the apng frame count goes once known
+  bool failed;      // the output went away, frames are thrown out
+  uint8_t png[4 + 2 + 5 + CAPTURE_PNG_DATA + 4]; // fdAT payload
+} capture_t;
+
+bool parse_capture_format(const char *name, capture_format_t *format);
+const char *capture_format_name(capture_format_t format);
+const char *capture_extension(capture_format_t format);
+capture_format_t capture_format_for(const char *path);
+bool start_capture(capture_t *c, const char *path, config_t config);
+void capture_frame(capture_t *c, const chip8_t *c8);
+bool stop_capture(capture_t *c);
+void print_capture_stats(const capture_t *c);
+
+#endif
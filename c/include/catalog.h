@@ -0,0 +1,58 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+// rom library index. a scan walks directories, hashes every rom on all
+// cores and guesses the platform it was written for from the instructions
+// its reachable code uses. the index is a TSV kept on disk, the next scan
+// only reads files whose size or mtime changed
+
+#include <stddef.h>
+
+#include "typedefs.h"
+
+#define CATALOG_DEFAULT "c8-catalog.tsv"
+#define CATALOG_HEADER "# c8 catalog 1"
+
+//  X(id, name, quirk profile, ips)
+#define PLATFORMS(X)                                                           \
+  X(CHIP8, chip8, QUIRKS_CHIP8, 700)                                           \
+  X(SCHIP, schip, QUIRKS_SCHIP, 1800)                                          \
+  X(XOCHIP, xochip, QUIRKS_XOCHIP, 12000)
+
+typedef enum Platform {
+#define X(id, ...) PLATFORM_##id,
+  PLATFORMS(X)
+#undef X
+  PLATFORM_COUNT,
+} platform_t;
+
+typedef struct CatalogEntry {
+  char *path;             // as found by the scan
+  uint64_t size;          // bytes
+  int64_t mtime;          // ns, with size decides whether to hash again
+  uint64_t hash;          // fnv1a of the image, the same as rom_hash
+  platform_t platform;    // newest instruction set the code uses
+  quirk_profile_t quirks; // suggested
+  uint32_t ips;           // suggested
+} catalog_entry_t;
+
+typedef struct Catalog {
+  catalog_entry_t *entries; // sorted by path
+  uint32_t n;
+  uint32_t hashed; // entries the last scan had to read
+} catalog_t;
+
+bool load_catalog(catalog_t *cat, const char *path);
+bool save_catalog(const catalog_t *cat, const char *path);
+bool scan_catalog(catalog_t *cat, char *const *dirs, uint32_t n_dirs,
+                  uint32_t threads);
+const catalog_entry_t *catalog_find(const catalog_t *cat, uint64_t hash);
+void free_catalog(catalog_t *cat);
+void guess_rom(catalog_entry_t *e, const uint8_t *rom, size_t size);
+bool lookup_rom(const catalog_t *cat, const uint8_t *rom, size_t size,
+                catalog_entry_t *e);
+void apply_entry(config_t *config, const catalog_entry_t *e);
+const char *platform_name(platform_t platform);
+void apply_catalog(config_t *config, const char *rom);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef CHIP8_H
+#define CHIP8_H
+
+#include <stddef.h>
+
+#include "typedefs.h"
+
+#define DEFAULT_SEED 0x2545F491u // CXNN sequence when nobody picks one
+
+bool init_c8(chip8_t *c8, char rom_name[]);
+bool load_c8(chip8_t *c8, char rom_name[], const uint8_t *rom, size_t rom_s);
+void seed_c8(chip8_t *c8, uint32_t seed);
+const uint8_t *map_rom(const char *path, size_t *size);
+void unmap_rom(const uint8_t *rom, size_t size);
+const char *fault_name(fault_t fault);
+
+#endif
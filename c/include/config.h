@@ -0,0 +1,8 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "typedefs.h"
+
+bool set_config_args(config_t *config, const int argc, char **argv);
+
+#endif
@@ -1,7 +1,26 @@
-#ifdef DEBUG
+#ifndef DEBUG_H
+#define DEBUG_H
+
+#include <stdio.h>
 
 #include "typedefs.h"
 
-void print_debug_info(chip8_t *c8);
+// same split emulator() does, for describing an opcode outside of it
+static inline instruction_t decode_instruction(const uint16_t op) {
+  return (instruction_t){
+      .opcode = op,
+      .NNN = op & 0x0FFF,
+      .NN = op & 0x0FF,
+      .N = op & 0x0F,
+      .X = (op >> 8) & 0x0F,
+      .Y = (op >> 4) & 0x0F,
+  };
+}
+
+void print_op(FILE *out, const chip8_t *c8, uint16_t addr, instruction_t ins);
 
+#ifdef DEBUG
+void print_debug_info(chip8_t *c8);
 #endif // -DDEBUG
+
+#endif
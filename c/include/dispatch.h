@@ -0,0 +1,16 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include "ops.h"
+
+// predecoded dispatch: one handler per possible opcode, so a cycle is
+// fetch + one indirect call, no decode and no nested switch. one table per
+// quirk profile, the quirk handlers in it have the profile built in
+extern op_fn op_table[QUIRK_COUNT][0x10000];
+
+void init_dispatch(quirk_profile_t profile);
+op_fn decode_op(uint16_t op, quirk_profile_t profile);
+bool op_ends_block(uint16_t op);
+uint32_t dispatch_run(chip8_t *c8, config_t config, uint32_t n);
+
+#endif
@@ -4,5 +4,7 @@
 #include "typedefs.h"
 
 void emulator(chip8_t *c8, config_t config);
+uint32_t emulator_run(chip8_t *c8, config_t config, uint32_t n);
+void update_timers(chip8_t *c8);
 
 #endif
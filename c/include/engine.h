@@ -0,0 +1,21 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "block.h"
+#include "jit.h"
+
+// per instance execution engine state, picked once from config.engine
+typedef struct Engine {
+  engine_kind_t kind;
+  block_cache_t *blocks; // ENGINE_BLOCK only
+  jit_t *jit;            // ENGINE_JIT only
+} engine_t;
+
+bool init_engine(engine_t *e, engine_kind_t kind, quirk_profile_t quirks);
+void free_engine(engine_t *e);
+uint32_t engine_run(engine_t *e, chip8_t *c8, config_t config, uint32_t n);
+const char *engine_name(engine_kind_t kind);
+bool parse_engine(const char *name, engine_kind_t *kind);
+void print_engine_stats(const engine_t *e);
+
+#endif
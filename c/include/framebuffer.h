@@ -0,0 +1,41 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+// everything outside the core reads the display through these, the
+// packing (a row_t per row and plane, MSB is x = 0) stays in here and ops.h
+
+#include "hash.h"
+#include "typedefs.h"
+
+#define DISPLAY_WIDTH 128 // hires, lores is the top left 64x32
+#define DISPLAY_HEIGHT 64
+#define ALL_ROWS (~0ull) // dirty_rows mask
+
+// size of the screen the rom sees in its current mode
+static inline uint32_t screen_width(const chip8_t *c8) {
+  return c8->hires ? DISPLAY_WIDTH : DISPLAY_WIDTH / 2;
+}
+
+static inline uint32_t screen_height(const chip8_t *c8) {
+  return c8->hires ? DISPLAY_HEIGHT : DISPLAY_HEIGHT / 2;
+}
+
+static inline row_t get_row(const chip8_t *c8, const uint32_t plane,
+                            const uint32_t y) {
+  return c8->display[plane][y];
+}
+
+// colour index, 0 = background, 1/2 = plane 1/2 only, 3 = both
+static inline uint8_t get_pixel(const chip8_t *c8, const uint32_t x,
+                                const uint32_t y) {
+  const uint32_t shift = DISPLAY_WIDTH - 1 - x;
+  return (c8->display[0][y] >> shift & 1) |
+         (c8->display[1][y] >> shift & 1) << 1;
+}
+
+// identifies a frame, batch results and regression checks compare these
+static inline uint64_t display_hash(const chip8_t *c8) {
+  return fnv1a(FNV_OFFSET, c8->display, sizeof c8->display);
+}
+
+#endif
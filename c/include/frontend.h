@@ -0,0 +1,15 @@
+#ifndef FRONTEND_H
+#define FRONTEND_H
+
+#include "SDL3/SDL.h"
+#include "typedefs.h"
+
+// SDL, only the windowed frontend sees this
+typedef struct mSDL {
+  SDL_Window *window;
+  SDL_Renderer *renderer;
+  SDL_Texture *texture;   // framebuffer, ARGB8888 streaming
+  SDL_AudioStream *audio; // buzzer, NULL when there is no sound
+} sdl_t;
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define FNV_OFFSET 0xCBF29CE484222325ull
+#define FNV_PRIME 0x100000001B3ull
+
+// FNV-1a 64, chain calls by passing the previous hash (start at FNV_OFFSET)
+static inline uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+  const uint8_t *p = data;
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= FNV_PRIME;
+  }
+  return h;
+}
+
+static inline uint64_t load_le64(const uint8_t *p) {
+  uint64_t w;
+  memcpy(&w, p, sizeof w);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  w = __builtin_bswap64(w);
+#endif
+  return w;
+}
+
+// the same step on 8 byte little endian words, four lanes interleaved so
+// the multiplies overlap, then folded. a checksum for large blobs (save
+// states) that runs near memory speed. not the value fnv1a() gives
+static inline uint64_t fnv1a_words(uint64_t h, const void *data, size_t len) {
+  const uint8_t *p = data;
+  uint64_t a = h, b = h ^ 1, c = h ^ 2, d = h ^ 3;
+  for (; len >= 32; p += 32, len -= 32) {
+    a = (a ^ load_le64(p)) * FNV_PRIME;
+    b = (b ^ load_le64(p + 8)) * FNV_PRIME;
+    c = (c ^ load_le64(p + 16)) * FNV_PRIME;
+    d = (d ^ load_le64(p + 24)) * FNV_PRIME;
+  }
+  const uint64_t lanes[4] = {a, b, c, d};
+  for (int i = 0; i < 4; i++) {
+    h = (h ^ lanes[i]) * FNV_PRIME;
+    h ^= h >> 32; // the multiply only carries up, bring the top back down
+  }
+  return fnv1a(h, p, len);
+}
+
+#endif
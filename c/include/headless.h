@@ -0,0 +1,14 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "capture.h"
+#include "rewind.h"
+#include "scheduler.h"
+
+// run flat out, no window, no delay. prints throughput, false if the run
+// could not be set up or its outputs (capture, profile, trace) written
+bool run_headless(chip8_t *c8, config_t config);
+uint64_t run_for(scheduler_t *s, chip8_t *c8, config_t config,
+                 uint64_t cycles, rewind_t *rw, capture_t *cap);
+
+#endif
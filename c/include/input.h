@@ -1,8 +1,9 @@
 #ifndef INPUT_H
 #define INPUT_H
 
-#include "typedefs.h"
+#include "frontend.h"
+#include "runner.h"
 
-void input_handler(chip8_t *c8);
+void input_handler(chip8_t *shown, runner_t *r);
 
 #endif
@@ -0,0 +1,44 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "typedefs.h"
+#include <stddef.h>
+
+// x86-64 dynamic recompiler. straight line runs of register ops are
+// translated into native code, everything else (DXYN, FX0A, calls, ram
+// writes, ...) is handed to the table interpreter one instruction at a time
+
+typedef void (*jit_fn)(chip8_t *c8);
+
+typedef enum JitState {
+  JIT_EMPTY,    // never looked at
+  JIT_NATIVE,   // fn runs len instructions
+  JIT_INTERP,   // first op can't be compiled (or keeps being rewritten)
+} jit_state_t;
+
+typedef struct JitBlock {
+  jit_state_t state;
+  uint8_t len;    // instructions executed by fn, on every path
+  uint8_t strikes; // times invalidated, self-modifying code gets interpreted
+  uint64_t pages; // ram pages the block was translated from
+  jit_fn fn;
+} jit_block_t;
+
+typedef struct Jit {
+  uint8_t *arena; // mmap'd, RW while emitting and RX while running
+  size_t size;
+  size_t used;
+  jit_block_t blocks[4096]; // by pc
+  uint64_t code_pages;      // pages with a translated block
+  uint64_t native;          // instructions run as native code
+  uint64_t interpreted;     // instructions handed to the interpreter
+  uint64_t compiled;        // blocks translated
+  uint64_t invalidations;   // blocks dropped by ram writes
+  uint64_t flushes;         // times the arena filled up and was reset
+} jit_t;
+
+jit_t *new_jit(void);
+void free_jit(jit_t *jit);
+uint32_t jit_run(jit_t *jit, chip8_t *c8, config_t config, uint32_t n);
+
+#endif
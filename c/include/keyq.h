@@ -0,0 +1,40 @@
+#ifndef KEYQ_H
+#define KEYQ_H
+
+#include "scheduler.h"
+
+#define KEYQ_SIZE 64        // events between two frames, a power of two
+#define LATENCY_BUCKETS 100 // 1ms each, the last one is everything slower
+
+typedef struct KeyEvent {
+  uint64_t ns; // when it happened, now_ns() clock
+  uint8_t key; // 0x0-0xF
+  bool down;
+} key_event_t;
+
+// key events waiting for the frame that covers their timestamp
+typedef struct KeyQueue {
+  key_event_t events[KEYQ_SIZE];
+  uint32_t head;               // next event to apply
+  uint32_t tail;               // next free slot
+  uint64_t unshown[KEYQ_SIZE]; // applied presses not yet presented
+  uint32_t n_unshown;
+} key_queue_t;
+
+// how long presses take to reach the screen
+typedef struct KeyLatency {
+  uint64_t latency[LATENCY_BUCKETS]; // presses per ms of input to present
+  uint64_t presses;
+  uint64_t latency_ns; // sum over all presses
+  uint64_t max_ns;
+} key_latency_t;
+
+void key_push(key_queue_t *q, chip8_t *c8, key_event_t ev);
+void key_flush(key_queue_t *q, chip8_t *c8);
+uint32_t run_frame_keys(key_queue_t *q, scheduler_t *s, chip8_t *c8,
+                        config_t config, uint64_t from, uint64_t to);
+void key_presented(key_latency_t *l, const uint64_t *pressed, uint32_t n,
+                   uint64_t now);
+void print_key_latency(const key_latency_t *l);
+
+#endif
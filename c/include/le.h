@@ -0,0 +1,22 @@
+#ifndef LE_H
+#define LE_H
+
+#include <stdint.h>
+
+// explicit little endian fields so files move between hosts
+
+static inline uint8_t *put_le(uint8_t *p, uint64_t v, const int bytes) {
+  for (int i = 0; i < bytes; i++, v >>= 8)
+    *p++ = v & 0xFF;
+  return p;
+}
+
+static inline uint64_t get_le(const uint8_t **p, const int bytes) {
+  uint64_t v = 0;
+  for (int i = 0; i < bytes; i++)
+    v |= (uint64_t)(*p)[i] << (8 * i);
+  *p += bytes;
+  return v;
+}
+
+#endif
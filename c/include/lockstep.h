@@ -0,0 +1,36 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include "typedefs.h"
+
+#define LANE_CHUNK 16 // lanes per vector op
+
+// many copies of one rom stepped together. the hot registers are stored
+// struct-of-arrays (V[x][lane]) so an opcode shared by a group of lanes
+// runs as vector ops, lanes that diverged run one at a time through
+// emulator(). ram, stack, keys and display stay in a chip8_t per lane
+typedef struct Lockstep {
+  uint32_t lanes;       // instances
+  uint32_t padded;      // lanes rounded up to LANE_CHUNK
+  uint8_t *V[16];       // V[x][lane]
+  uint16_t *I;          // I[lane]
+  uint16_t *PC;         // PC[lane]
+  uint8_t *delay_timer; // delay_timer[lane]
+  uint8_t *sound_timer; // sound_timer[lane]
+  uint16_t *op;         // opcode fetched by each lane this step
+  uint8_t *mask;        // 0xFF for lanes in the group being run
+  uint8_t *pending;     // 0xFF for lanes not stepped yet this step
+  bool shared_ram;      // every lane's ram is identical
+  chip8_t *c8;          // per lane ram, stack, keys and display
+  uint64_t vector_ops;  // lane instructions run in a vector group
+  uint64_t scalar_ops;  // lane instructions run on their own
+  uint64_t groups;      // vector groups run
+} lockstep_t;
+
+bool init_lockstep(lockstep_t *ls, const chip8_t *proto, uint32_t lanes);
+void free_lockstep(lockstep_t *ls);
+void lockstep_step(lockstep_t *ls, config_t config);
+void lockstep_end_frame(lockstep_t *ls);
+chip8_t *lockstep_lane(lockstep_t *ls, uint32_t lane);
+
+#endif
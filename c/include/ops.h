@@ -0,0 +1,596 @@
+#ifndef OPS_H
+#define OPS_H
+
+// instruction semantics, shared by every execution engine. each op pulls
+// only the operands it needs out of the raw opcode, PC has already been
+// advanced past it
+
+#include "framebuffer.h"
+#include "profile.h"
+#include "typedefs.h"
+#include <string.h>
+
+// operand extraction
+#define OP_NNN(op) ((op) & 0x0FFF)
+#define OP_NN(op) ((op) & 0x00FF)
+#define OP_N(op) ((op) & 0x000F)
+#define OP_X(op) (((op) >> 8) & 0x0F)
+#define OP_Y(op) (((op) >> 4) & 0x0F)
+
+typedef void (*op_fn)(chip8_t *c8, const config_t *config, uint16_t op);
+
+#define RAM_PAGE_SHIFT 6 // 4K ram / 64 pages, one bit each in dirty_pages
+#define CODE_SIZE 0x1000 // decode caches cover pc below this
+#define BIG_FONT 0x50    // schip 8x10 digits, after the 4x5 ones
+
+// ram page of addr. xo-chip ram past 4K counts as the last page, nothing
+// is decoded from there but lockstep still sees the write
+static inline uint32_t ram_page(const uint32_t addr) {
+  return addr < CODE_SIZE ? addr >> RAM_PAGE_SHIFT : 63;
+}
+
+// every ram write goes through here so decoded code can be thrown away
+static inline void mark_ram(chip8_t *c8, uint16_t addr, uint16_t len) {
+  const uint32_t first = ram_page(addr);
+  const uint32_t last = ram_page((uint16_t)(addr + len - 1));
+  if (last < first) {
+    c8->dirty_pages |= ~0ull << first | ((2ull << last) - 1); // wrapped
+    return;
+  }
+  // bits first..last, (2 << 63) wrapping to 0 still gives the right mask
+  c8->dirty_pages |= (2ull << last) - (1ull << first);
+}
+
+// the opcode at addr, ram wraps at 64K
+static inline uint16_t fetch(const chip8_t *c8, const uint16_t addr) {
+  return c8->ram[addr] << 8 | c8->ram[(uint16_t)(addr + 1)];
+}
+
+// skips step over F000 NNNN as a whole, the one 4 byte instruction
+static inline uint16_t skip_len(const chip8_t *c8) {
+  return 2 + 2 * (fetch(c8, c8->PC) == 0xF000);
+}
+
+// the part of a row on screen, lores leaves the low 64 bits unused
+static inline row_t screen_mask(const chip8_t *c8) {
+  return c8->hires ? ~(row_t)0 : ~(row_t)0 << 64;
+}
+
+// 0NNN, not implemented / unknown sub op
+static inline void op_nop(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)c8, (void)config, (void)op;
+}
+
+// 00E0 clear the selected planes. rows below the screen are always blank
+static inline void op_00e0(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config, (void)op;
+  const uint32_t h = screen_height(c8);
+  for (uint32_t p = 0; p < 2; p++)
+    if (c8->planes & (1u << p))
+      memset(c8->display[p], 0, h * sizeof(row_t));
+  c8->dirty_rows = ~0ull;
+}
+
+// 00CN scroll the selected planes down N rows
+static inline void op_00cn(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  const uint32_t h = screen_height(c8);
+  const uint32_t n = OP_N(op);
+  for (uint32_t p = 0; p < 2; p++) {
+    if (!(c8->planes & (1u << p)))
+      continue;
+    memmove(&c8->display[p][n], &c8->display[p][0], (h - n) * sizeof(row_t));
+    memset(&c8->display[p][0], 0, n * sizeof(row_t));
+  }
+  c8->dirty_rows = ~0ull;
+}
+
+// 00DN scroll the selected planes up N rows (xo-chip)
+static inline void op_00dn(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  const uint32_t h = screen_height(c8);
+  const uint32_t n = OP_N(op);
+  for (uint32_t p = 0; p < 2; p++) {
+    if (!(c8->planes & (1u << p)))
+      continue;
+    memmove(&c8->display[p][0], &c8->display[p][n], (h - n) * sizeof(row_t));
+    memset(&c8->display[p][h - n], 0, n * sizeof(row_t));
+  }
+  c8->dirty_rows = ~0ull;
+}
+
+// 00FB/00FC scroll the selected planes 4 pixels right/left, one wide shift
+// per row
+static inline void scroll_x(chip8_t *c8, const bool right) {
+  const uint32_t h = screen_height(c8);
+  const row_t mask = screen_mask(c8);
+  for (uint32_t p = 0; p < 2; p++) {
+    if (!(c8->planes & (1u << p)))
+      continue;
+    row_t *d = c8->display[p];
+    for (uint32_t y = 0; y < h; y++)
+      d[y] = (right ? d[y] >> 4 : d[y] << 4) & mask;
+  }
+  c8->dirty_rows = ~0ull;
+}
+
+static inline void op_00fb(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config, (void)op;
+  scroll_x(c8, true);
+}
+
+static inline void op_00fc(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config, (void)op;
+  scroll_x(c8, false);
+}
+
+// 00FD exit the interpreter
+static inline void op_00fd(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config, (void)op;
+  c8->state = QUIT;
+}
+
+// 00FE lores / 00FF hires. the screen is cleared, as octo does
+static inline void set_hires(chip8_t *c8, const bool hires) {
+  c8->hires = hires;
+  memset(c8->display, 0, sizeof c8->display);
+  c8->dirty_rows = ~0ull;
+}
+
+static inline void op_00fe(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config, (void)op;
+  set_hires(c8, false);
+}
+
+static inline void op_00ff(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config, (void)op;
+  set_hires(c8, true);
+}
+
+// stop the machine on something no rom can recover from
+static inline void fault(chip8_t *c8, const fault_t fault) {
+  c8->fault = fault;
+  c8->state = QUIT;
+}
+
+// 00EE return from subroutine
+static inline void op_00ee(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config, (void)op;
+  if (c8->SP == c8->stack) {
+    fault(c8, FAULT_STACK_UNDERFLOW);
+    return;
+  }
+  c8->PC = *--c8->SP;
+}
+
+// 1NNN goto address
+static inline void op_1nnn(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->PC = OP_NNN(op);
+}
+
+// 2NNN call subroutine
+static inline void op_2nnn(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  if (c8->SP == c8->stack + STACK_SIZE) {
+    fault(c8, FAULT_STACK_OVERFLOW);
+    return;
+  }
+  *c8->SP++ = c8->PC;
+  c8->PC = OP_NNN(op);
+}
+
+// 3XNN if VX == NN, skip next instruction
+static inline void op_3xnn(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  if (c8->V[OP_X(op)] == OP_NN(op))
+    c8->PC += skip_len(c8);
+}
+
+// 4XNN if VX != NN, skip next instruction
+static inline void op_4xnn(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  if (c8->V[OP_X(op)] != OP_NN(op))
+    c8->PC += skip_len(c8);
+}
+
+// 5XY0 if VX == VY, skip next instruction
+static inline void op_5xy0(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  if (c8->V[OP_X(op)] == c8->V[OP_Y(op)])
+    c8->PC += skip_len(c8);
+}
+
+// 5XY2 save VX..VY at I, either order, I stays (xo-chip)
+static inline void op_5xy2(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  const uint8_t x = OP_X(op), y = OP_Y(op);
+  const uint8_t n = (x < y ? y - x : x - y) + 1;
+  for (uint8_t i = 0; i < n; i++)
+    c8->ram[(uint16_t)(c8->I + i)] = c8->V[x < y ? x + i : x - i];
+  mark_ram(c8, c8->I, n);
+}
+
+// 5XY3 load VX..VY from I, either order, I stays (xo-chip)
+static inline void op_5xy3(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  const uint8_t x = OP_X(op), y = OP_Y(op);
+  const uint8_t n = (x < y ? y - x : x - y) + 1;
+  for (uint8_t i = 0; i < n; i++)
+    c8->V[x < y ? x + i : x - i] = c8->ram[(uint16_t)(c8->I + i)];
+}
+
+// 6XNN set VX = NN
+static inline void op_6xnn(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->V[OP_X(op)] = OP_NN(op);
+}
+
+// 7XNN add NN to VX, no carry
+static inline void op_7xnn(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->V[OP_X(op)] += OP_NN(op);
+}
+
+// 8XY0 set VX = VY
+static inline void op_8xy0(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->V[OP_X(op)] = c8->V[OP_Y(op)];
+}
+
+// 8XY1 VX |= VY, vf_reset clears VF
+static inline void op_8xy1(chip8_t *c8, const config_t *config, uint16_t op,
+                           const quirks_t q) {
+  (void)config;
+  c8->V[OP_X(op)] |= c8->V[OP_Y(op)];
+  if (q.vf_reset)
+    c8->V[0xF] = 0;
+}
+
+// 8XY2 VX &= VY, vf_reset clears VF
+static inline void op_8xy2(chip8_t *c8, const config_t *config, uint16_t op,
+                           const quirks_t q) {
+  (void)config;
+  c8->V[OP_X(op)] &= c8->V[OP_Y(op)];
+  if (q.vf_reset)
+    c8->V[0xF] = 0;
+}
+
+// 8XY3 VX ^= VY, vf_reset clears VF
+static inline void op_8xy3(chip8_t *c8, const config_t *config, uint16_t op,
+                           const quirks_t q) {
+  (void)config;
+  c8->V[OP_X(op)] ^= c8->V[OP_Y(op)];
+  if (q.vf_reset)
+    c8->V[0xF] = 0;
+}
+
+// 8XY4 VX += VY, VF = carry
+static inline void op_8xy4(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  const bool carry = ((uint16_t)(c8->V[OP_X(op)] + c8->V[OP_Y(op)]) > 255);
+  c8->V[OP_X(op)] += c8->V[OP_Y(op)];
+  c8->V[0xF] = carry;
+}
+
+// 8XY5 VX -= VY, VF = !borrow
+static inline void op_8xy5(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  const bool carry = (c8->V[OP_Y(op)] <= c8->V[OP_X(op)]);
+  c8->V[OP_X(op)] -= c8->V[OP_Y(op)];
+  c8->V[0xF] = carry;
+}
+
+// 8XY6 VX = VY >> 1 (VX >>= 1 with shift_vx), VF = shifted out bit
+static inline void op_8xy6(chip8_t *c8, const config_t *config, uint16_t op,
+                           const quirks_t q) {
+  (void)config;
+  const uint8_t v = c8->V[q.shift_vx ? OP_X(op) : OP_Y(op)];
+  c8->V[OP_X(op)] = v >> 1;
+  c8->V[0xF] = v & 1;
+}
+
+// 8XY7 VX = VY - VX, VF = !borrow
+static inline void op_8xy7(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  const bool carry = (c8->V[OP_X(op)] <= c8->V[OP_Y(op)]);
+  c8->V[OP_X(op)] = c8->V[OP_Y(op)] - c8->V[OP_X(op)];
+  c8->V[0xF] = carry;
+}
+
+// 8XYE VX = VY << 1 (VX <<= 1 with shift_vx), VF = shifted out bit
+static inline void op_8xye(chip8_t *c8, const config_t *config, uint16_t op,
+                           const quirks_t q) {
+  (void)config;
+  const uint8_t v = c8->V[q.shift_vx ? OP_X(op) : OP_Y(op)];
+  c8->V[OP_X(op)] = v << 1;
+  c8->V[0xF] = v >> 7;
+}
+
+// 9XY0 if VX != VY, skip next instruction
+static inline void op_9xy0(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  if (c8->V[OP_X(op)] != c8->V[OP_Y(op)])
+    c8->PC += skip_len(c8);
+}
+
+// ANNN set I to NNN
+static inline void op_annn(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->I = OP_NNN(op);
+}
+
+// BNNN set PC = V0 + NNN, BXNN = VX + XNN with jump_vx
+static inline void op_bnnn(chip8_t *c8, const config_t *config, uint16_t op,
+                           const quirks_t q) {
+  (void)config;
+  c8->PC = c8->V[q.jump_vx ? OP_X(op) : 0] + OP_NNN(op);
+}
+
+// CXNN set VX = random & NN, xorshift32 kept per instance
+static inline void op_cxnn(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  uint32_t x = c8->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  c8->rng = x;
+  c8->V[OP_X(op)] = (x >> 24) & OP_NN(op);
+}
+
+// dirty_rows bits for n rows from y on an h row screen, wrapping past the
+// bottom. n <= 16
+static inline uint64_t row_span(const uint32_t y, const uint32_t n,
+                                const uint32_t h) {
+  const uint64_t m = (1ull << n) - 1;
+  const uint64_t screen = h == 64 ? ~0ull : (1ull << h) - 1;
+  return (m << y | (y ? m >> (h - y) : 0)) & screen;
+}
+
+// a sprite row (MSB first) at x, rotated around the right edge of the
+// screen instead of falling off it
+static inline row_t wrap_row(const chip8_t *c8, const uint16_t bits,
+                             const uint32_t x) {
+  if (!c8->hires) {
+    const uint64_t b = (uint64_t)bits << 48;
+    return (row_t)(b >> x | b << (-x & 63)) << 64;
+  }
+  const row_t b = (row_t)bits << (DISPLAY_WIDTH - 16);
+  return b >> x | b << (-x & 127);
+}
+
+// DXYN in lores with one plane, the plain chip-8 case. 8 pixel sprites
+// stay in the top word of a row (the whole lores screen), so it is 64 bit
+// ops as before xo-chip
+static inline void draw_lores(chip8_t *c8, const uint16_t op, const bool wrap) {
+  const uint8_t X_coord = c8->V[OP_X(op)] & 63;
+  const uint8_t Y_coord = c8->V[OP_Y(op)] & 31;
+  const uint32_t left = 32 - Y_coord;
+  // stop at the bottom unless wrapping
+  const uint32_t rows = wrap || OP_N(op) < left ? OP_N(op) : left;
+  row_t *d = c8->display[0];
+  uint64_t hit = 0;
+  uint32_t pixels = 0;
+
+  for (uint32_t i = 0; i < rows; i++) {
+    // sprite data = I + loop [i], MSB lines up with X_coord
+    const uint64_t bits = (uint64_t)c8->ram[(uint16_t)(c8->I + i)] << 56;
+    const uint64_t row =
+        wrap ? bits >> X_coord | bits << (-X_coord & 63) : bits >> X_coord;
+    const uint32_t y = (Y_coord + i) & 31;
+    hit |= (uint64_t)(d[y] >> 64) & row;
+    d[y] ^= (row_t)row << 64;
+    if (c8->prof)
+      pixels += __builtin_popcountll(row);
+  }
+  c8->dirty_rows |=
+      wrap ? row_span(Y_coord, rows, 32) : ((1ull << rows) - 1) << Y_coord;
+  c8->V[0xF] = hit != 0; // carry flag = any pixel turned off
+  if (c8->prof)
+    profile_draw(c8->prof, pixels, hit != 0);
+}
+
+// DXYN draw at [VX,VY] with a height of N, DXY0 draws 16x16. each sprite
+// row is shifted into place once, collision is one AND and drawing one
+// XOR per row and plane. with both planes selected the second plane's
+// sprite follows the first in ram. bits shifted past the right or bottom
+// edge fall off (clipped), or come back in on the other side with wrap
+static inline void op_dxyn(chip8_t *c8, const config_t *config, uint16_t op,
+                           const quirks_t q) {
+  (void)config;
+  if (!c8->hires && OP_N(op) != 0 && c8->planes == 1) {
+    draw_lores(c8, op, q.wrap);
+    return;
+  }
+  const uint32_t h = screen_height(c8);
+  const uint8_t X_coord = c8->V[OP_X(op)] & (screen_width(c8) - 1);
+  const uint8_t Y_coord = c8->V[OP_Y(op)] & (h - 1);
+  const bool big = OP_N(op) == 0;
+  const uint32_t height = big ? 16 : OP_N(op);
+  const uint32_t left = h - Y_coord;
+  const uint32_t rows = q.wrap || height < left ? height : left;
+  const row_t mask = screen_mask(c8);
+  uint16_t addr = c8->I;
+  row_t hit = 0;
+  uint32_t pixels = 0;
+
+  for (uint32_t p = 0; p < 2; p++) {
+    if (!(c8->planes & (1u << p)))
+      continue;
+    row_t *d = c8->display[p];
+    for (uint32_t i = 0; i < rows; i++) {
+      const uint16_t bits = big ? fetch(c8, addr + 2 * i)
+                                : c8->ram[(uint16_t)(addr + i)] << 8;
+      const row_t row =
+          q.wrap ? wrap_row(c8, bits, X_coord)
+                 : ((row_t)bits << (DISPLAY_WIDTH - 16) >> X_coord) & mask;
+      const uint32_t y = (Y_coord + i) & (h - 1);
+      hit |= d[y] & row;
+      d[y] ^= row;
+      if (c8->prof)
+        pixels += __builtin_popcountll((uint64_t)(row >> 64)) +
+                  __builtin_popcountll((uint64_t)row);
+    }
+    addr += big ? 32 : height;
+  }
+  c8->dirty_rows |= q.wrap ? row_span(Y_coord, rows, h)
+                           : ((1ull << rows) - 1) << Y_coord;
+  c8->V[0xF] = hit != 0; // carry flag = any pixel turned off
+  if (c8->prof)
+    profile_draw(c8->prof, pixels, hit != 0);
+}
+
+// EX9E if key VX is down, skip next instruction
+static inline void op_ex9e(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  if (c8->keys[c8->V[OP_X(op)] & 0xF])
+    c8->PC += skip_len(c8);
+}
+
+// EXA1 if key VX is up, skip next instruction
+static inline void op_exa1(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  if (!c8->keys[c8->V[OP_X(op)] & 0xF])
+    c8->PC += skip_len(c8);
+}
+
+// FX07 set VX to delay_timer value
+static inline void op_fx07(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->V[OP_X(op)] = c8->delay_timer;
+}
+
+// FX0A set VX = key pressed. waits for a press and then for that key's
+// release, the key being waited on lives in c8 so instances don't share it
+static inline void op_fx0a(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  if (c8->wait_key == 0xFF) {
+    for (uint8_t i = 0; i < sizeof c8->keys; i++) {
+      if (c8->keys[i]) {
+        c8->wait_key = i;
+        break;
+      }
+    }
+    c8->PC -= 2; // nothing yet, or wait for it to come back up
+  } else if (c8->keys[c8->wait_key]) {
+    c8->PC -= 2; // busy loop, wait for key up
+  } else {
+    c8->V[OP_X(op)] = c8->wait_key;
+    c8->wait_key = 0xFF;
+  }
+}
+
+// FX15 set delay timer
+static inline void op_fx15(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->delay_timer = c8->V[OP_X(op)];
+}
+
+// FX18 set sound timer
+static inline void op_fx18(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->sound_timer = c8->V[OP_X(op)];
+}
+
+// FX1E add VX to I
+static inline void op_fx1e(chip8_t *c8, const config_t *config, uint16_t op,
+                           const quirks_t q) {
+  (void)config;
+  c8->I += c8->V[OP_X(op)];
+  // amiga sets carry flag, 1 known game relies on it so...
+  if (q.i_overflow)
+    c8->V[0x0F] = c8->I > 0x0FFF;
+}
+
+// FX29 set I to location of sprite
+static inline void op_fx29(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->I = c8->V[OP_X(op)] * 5;
+}
+
+// FX30 set I to the big (8x10) digit VX (schip)
+static inline void op_fx30(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->I = BIG_FONT + (c8->V[OP_X(op)] & 0xF) * 10;
+}
+
+// F000 NNNN set I to the 16 bit address that follows (xo-chip)
+static inline void op_f000(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config, (void)op;
+  c8->I = fetch(c8, c8->PC);
+  c8->PC += 2;
+}
+
+// FN01 select the planes DXYN, 00E0 and the scrolls act on (xo-chip)
+static inline void op_fn01(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->planes = OP_X(op) & 3;
+}
+
+// F002 load 16 bytes at I into the audio pattern (xo-chip)
+static inline void op_f002(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config, (void)op;
+  for (uint8_t i = 0; i < sizeof c8->pattern; i++)
+    c8->pattern[i] = c8->ram[(uint16_t)(c8->I + i)];
+  c8->xo_audio = true;
+}
+
+// FX3A set the audio pattern playback rate (xo-chip)
+static inline void op_fx3a(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  c8->pitch = c8->V[OP_X(op)];
+}
+
+// FX33 Binary Coded Decimal of VX
+static inline void op_fx33(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  uint8_t bcd = c8->V[OP_X(op)];
+  // 1's in I+2
+  c8->ram[(uint16_t)(c8->I + 2)] = bcd % 10;
+  bcd /= 10;
+  // 10's in I+1
+  c8->ram[(uint16_t)(c8->I + 1)] = bcd % 10;
+  bcd /= 10;
+  // 100's in I
+  c8->ram[c8->I] = bcd;
+  mark_ram(c8, c8->I, 3);
+}
+
+// FX55 dump V0-VX into memory starting at I, mem_inc moves I past them
+static inline void op_fx55(chip8_t *c8, const config_t *config, uint16_t op,
+                           const quirks_t q) {
+  (void)config;
+  const uint8_t n = OP_X(op) + 1;
+  if (c8->I + n > sizeof c8->ram)
+    return;
+  memcpy(&c8->ram[c8->I], c8->V, n);
+  mark_ram(c8, c8->I, n);
+  if (q.mem_inc)
+    c8->I += n;
+}
+
+// FX65 restore V0-VX from memory starting at I, mem_inc moves I past them
+static inline void op_fx65(chip8_t *c8, const config_t *config, uint16_t op,
+                           const quirks_t q) {
+  (void)config;
+  const uint8_t n = OP_X(op) + 1;
+  if (c8->I + n > sizeof c8->ram)
+    return;
+  memcpy(c8->V, &c8->ram[c8->I], n);
+  if (q.mem_inc)
+    c8->I += n;
+}
+
+// FX75 save V0-VX to the persistent flags (schip)
+static inline void op_fx75(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  memcpy(c8->flags, c8->V, OP_X(op) + 1);
+}
+
+// FX85 restore V0-VX from the persistent flags (schip)
+static inline void op_fx85(chip8_t *c8, const config_t *config, uint16_t op) {
+  (void)config;
+  memcpy(c8->V, c8->flags, OP_X(op) + 1);
+}
+
+#endif
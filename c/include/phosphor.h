@@ -0,0 +1,28 @@
+#ifndef PHOSPHOR_H
+#define PHOSPHOR_H
+
+// fading pixels for the window. every pixel of both planes has a level
+// that jumps to 255 while it is lit and loses a share each 60Hz tick once
+// it goes out, so a sprite XOR-erased and redrawn a frame later dims for
+// a frame instead of blinking. no SDL in here, the bench runs it too
+
+#include "framebuffer.h"
+
+#define PHOSPHOR_CHUNK 16 // pixels per vector op
+
+typedef struct Phosphor {
+  uint8_t level[2][DISPLAY_HEIGHT][DISPLAY_WIDTH]; // by plane, 255 = lit
+  uint32_t palette[4]; // ARGB, indexed by plane 1 | plane 2 << 1
+  uint32_t keep;       // of 256, what an unlit pixel keeps per tick
+  uint32_t factor;     // of 256, the decay phosphor_row() applies now
+  uint64_t fading;     // rows with a pixel on its way out
+  uint64_t tick_ns;    // the last tick decayed
+  bool hires;          // mode the levels belong to
+} phosphor_t;
+
+void init_phosphor(phosphor_t *ph, config_t config);
+uint64_t phosphor_advance(phosphor_t *ph, const chip8_t *c8, uint64_t now);
+void phosphor_row(phosphor_t *ph, const chip8_t *c8, uint32_t y,
+                  uint32_t *dst);
+
+#endif
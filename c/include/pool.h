@@ -0,0 +1,15 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// runs job 0..n_jobs-1 on n_threads workers. jobs start out split into
+// one contiguous range per worker, a worker that runs dry steals half of
+// the remaining range of another. fn gets the job index and worker id
+typedef void (*pool_fn)(void *ctx, uint32_t job, uint32_t worker);
+
+bool pool_run(uint32_t n_jobs, uint32_t n_threads, pool_fn fn, void *ctx);
+uint32_t pool_default_threads(void);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "typedefs.h"
+
+#define PROFILE_PERIOD 97   // instructions per sample, prime against loops
+#define PROFILE_STACKS 1024 // distinct call stacks kept, the rest is [other]
+
+struct Engine; // engine.h, kept out so ops.h can include this
+
+// where the host spends a frame
+typedef enum ProfileSection {
+  PROF_EMULATION,
+  PROF_INPUT,
+  PROF_RENDER,
+  PROF_WAIT,
+  PROF_SECTIONS,
+} profile_section_t;
+
+typedef struct ProfileStack {
+  uint64_t samples;
+  uint8_t depth;
+  uint16_t calls[STACK_SIZE]; // subroutine entry points, outermost first
+} profile_stack_t;
+
+// sampling profiler: every PROFILE_PERIOD instructions the PC, its opcode
+// class and the CHIP-8 call stack are recorded, so the cost is a counter
+// compare per engine_run() slice no matter which engine runs. DXYN pixels
+// and collisions are counted exactly (c8->prof is checked in op_dxyn)
+typedef struct Profile {
+  uint32_t countdown;      // instructions until the next sample
+  uint64_t samples;        // samples taken
+  uint64_t pc[4096];       // samples per address
+  uint64_t classes[64];    // samples per opcode class, see profile.c
+  uint64_t draws;          // DXYN executed
+  uint64_t pixels;         // sprite pixels drawn
+  uint64_t collisions;     // draws that turned a pixel off
+  uint64_t ns[PROF_SECTIONS];
+  profile_stack_t stacks[PROFILE_STACKS];
+  uint64_t other_stacks; // samples whose stack did not fit
+} profile_t;
+
+// exact DXYN counts, called from op_dxyn when profiling
+static inline void profile_draw(profile_t *p, const uint32_t pixels,
+                                const bool hit) {
+  p->draws++;
+  p->pixels += pixels;
+  p->collisions += hit;
+}
+
+profile_t *new_profile(void);
+void free_profile(profile_t *p);
+uint32_t profile_run(profile_t *p, struct Engine *e, chip8_t *c8,
+                     config_t config, uint32_t n);
+void profile_time(profile_t *p, profile_section_t section, uint64_t *since);
+bool write_profile(const profile_t *p, const chip8_t *c8, const char *prefix);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef QUIRKS_H
+#define QUIRKS_H
+
+// behaviour that differs between chip-8 variants. the interpreters are
+// instantiated once per profile below with its quirks_t as a constant, so
+// a handler never tests a quirk at run time. picked with --quirks
+
+#include <stdbool.h>
+
+typedef struct Quirks {
+  bool shift_vx;   // 8XY6/8XYE shift VX in place instead of VX = VY shifted
+  bool vf_reset;   // 8XY1/8XY2/8XY3 clear VF
+  bool jump_vx;    // BXNN jumps to VX + XNN instead of BNNN to V0 + NNN
+  bool i_overflow; // FX1E sets VF when I goes past 0xFFF
+  bool wrap;       // DXYN wraps at the screen edges instead of clipping
+  bool mem_inc;    // FX55/FX65 leave I past the last register
+} quirks_t;
+
+//  X(id, name, shift_vx, vf_reset, jump_vx, i_overflow, wrap, mem_inc)
+#define QUIRK_PROFILES(X)                                                      \
+  X(CHIP8, chip8, false, true, false, false, false, true)                      \
+  X(SCHIP, schip, true, false, true, false, false, false)                      \
+  X(XOCHIP, xochip, false, false, false, false, true, true)                    \
+  X(AMIGA, amiga, false, true, false, true, false, true)
+
+typedef enum QuirkProfile {
+#define X(id, ...) QUIRKS_##id,
+  QUIRK_PROFILES(X)
+#undef X
+  QUIRK_COUNT,
+} quirk_profile_t;
+
+// quirks_chip8, quirks_schip, ... as compile time constants
+#define X(id, name, ...) static const quirks_t quirks_##name = {__VA_ARGS__};
+QUIRK_PROFILES(X)
+#undef X
+
+quirks_t profile_quirks(quirk_profile_t profile);
+const char *quirks_name(quirk_profile_t profile);
+bool parse_quirks(const char *name, quirk_profile_t *profile);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "capture.h"
+#include "scheduler.h"
+
+// input recording, all fields little endian:
+//   magic "C8RP", u16 version, u16 quirk profile (quirks.h order),
+//   u64 rom hash, u32 seed, u32 ips, u32 frames, u32 runs, runs of
+//   (u16 key mask, u16 frames), u64 fnv1a checksum of everything before it
+// keys are sampled once per frame, which is as often as the frontend
+// polls them, so a replay runs exactly the recorded workload
+#define REPLAY_MAGIC "C8RP"
+#define REPLAY_VERSION 2
+
+typedef struct Replay {
+  uint64_t rom_hash;
+  uint32_t seed;
+  uint32_t ips;
+  quirk_profile_t quirks;
+  uint16_t *keys; // key mask per frame, bit k is key k
+  uint32_t frames;
+  uint32_t cap;
+  uint32_t pos; // next frame to play back
+} replay_t;
+
+bool init_replay(replay_t *rp, const chip8_t *c8, config_t config);
+void free_replay(replay_t *rp);
+bool replay_capture(replay_t *rp, const chip8_t *c8);
+void replay_drop(replay_t *rp, uint32_t frames);
+bool replay_feed(replay_t *rp, chip8_t *c8);
+bool save_replay(const replay_t *rp, const char *path);
+bool load_replay(replay_t *rp, const chip8_t *c8, const char *path);
+uint64_t run_replay(replay_t *rp, scheduler_t *s, chip8_t *c8,
+                    config_t config, capture_t *cap);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <stddef.h>
+
+#include "scheduler.h"
+
+#define REWIND_KEYFRAME 60         // a full snapshot every second
+#define REWIND_BYTES_PER_SEC 32768 // ring budget, deltas are far smaller
+
+// machine state as the rewind ring sees it, no pointers and no padding so
+// it can be XORed and compared as uint64_t words
+typedef struct RewindSnap {
+  uint64_t display[2 * 64 * 2]; // both planes, row_t as two words
+  uint32_t rng;
+  uint16_t stack[STACK_SIZE];
+  uint16_t I;
+  uint16_t PC;
+  uint8_t ram[RAM_SIZE];
+  uint8_t V[16];
+  uint8_t flags[16];
+  uint8_t pattern[16];
+  uint8_t depth; // SP - stack
+  uint8_t delay_timer;
+  uint8_t sound_timer;
+  uint8_t wait_key;
+  uint8_t mode; // hires | planes << 1 | xo_audio << 3
+  uint8_t pitch;
+  uint8_t budget;   // scheduler carry (< TIMER_HZ), sets the next frames' ips
+  uint8_t spare[1]; // keeps the size a multiple of 8
+} rewind_snap_t;
+
+#define SNAP_WORDS (sizeof(rewind_snap_t) / sizeof(uint64_t))
+
+typedef struct RewindEntry {
+  size_t offset; // into data
+  uint32_t len;  // encoded bytes
+  bool keyframe; // encoded on its own, otherwise XOR against the keyframe
+} rewind_entry_t;
+
+// last N seconds of frames. each frame is XORed against the newest
+// keyframe and run length encoded (unchanged words cost nothing), entries
+// live in a fixed byte ring and the oldest are dropped until the oldest
+// left is a keyframe
+typedef struct Rewind {
+  uint8_t *data;           // byte ring
+  size_t size;             // bytes in data
+  size_t head;             // next write offset
+  rewind_entry_t *entries; // entry ring, oldest at first
+  uint32_t cap;            // frames kept at most
+  uint32_t first;          // oldest entry
+  uint32_t count;          // entries held
+  uint32_t since_key;      // frames recorded since the newest keyframe
+  rewind_snap_t key;       // newest keyframe, the XOR base
+  rewind_snap_t snap;      // scratch
+  uint8_t *scratch;        // encode buffer, worst case size
+  uint64_t frames;         // frames recorded
+  uint64_t record_ns;      // time spent recording
+  uint64_t raw_bytes;      // snapshot bytes recorded
+  uint64_t packed_bytes;   // bytes they encoded to
+} rewind_t;
+
+bool init_rewind(rewind_t *rw, uint32_t seconds);
+void free_rewind(rewind_t *rw);
+void rewind_record(rewind_t *rw, const chip8_t *c8, const scheduler_t *s);
+bool rewind_step(rewind_t *rw, chip8_t *c8, scheduler_t *s);
+void print_rewind_stats(const rewind_t *rw);
+
+#endif
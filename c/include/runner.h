@@ -0,0 +1,90 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+#include "audio.h"
+#include "capture.h"
+#include "keyq.h"
+#include "replay.h"
+#include "rewind.h"
+#include "scheduler.h"
+
+#define RUNNER_COMMANDS 256 // frontend to emulation queue, a power of two
+#define FRAME_FRESH 0x4     // set in middle while the reader has not taken it
+
+typedef enum CommandKind {
+  CMD_KEY,    // chip8 key event
+  CMD_PAUSE,  // toggle pause
+  CMD_REWIND, // on: step back while held
+  CMD_SAVE,   // quick save to [rom].state
+  CMD_LOAD,   // quick load from [rom].state
+  CMD_TRACE,  // write the trace ring
+  CMD_QUIT,
+} command_kind_t;
+
+typedef struct Command {
+  command_kind_t kind;
+  bool on;         // CMD_REWIND
+  key_event_t key; // CMD_KEY
+} command_t;
+
+// a finished frame as the emulation thread hands it over
+typedef struct Frame {
+  row_t display[2][64];
+  uint64_t dirty_rows;         // rows changed since the reader's last frame
+  bool hires;
+  uint64_t seq;                // frames published before this one
+  bool paced;                  // no pause or sleep since the last one
+  uint64_t pressed[KEYQ_SIZE]; // key presses this frame is the first to show
+  uint32_t n_pressed;
+} frame_t;
+
+// runs the emulator on its own thread. the frontend sends commands through
+// a lock-free SPSC ring and takes frames from a lock-free triple buffer:
+// the writer always has a slot to draw into, the reader always has the
+// newest finished one and neither waits on the other
+typedef struct Runner {
+  // emulation thread only while it runs
+  chip8_t *c8;
+  scheduler_t *sched;
+  rewind_t *rw;   // NULL: no rewind
+  replay_t *rp;   // NULL: not recording
+  audio_t *audio; // NULL: no sound
+  capture_t *cap; // NULL: no frame capture
+  config_t config;
+  key_queue_t keys;
+  uint8_t back;   // slot being drawn
+  bool unpaced;   // paused or slept since the last published frame
+  uint64_t published;
+  // handoff
+  frame_t frames[3];
+  _Alignas(64) atomic_uint middle; // last published slot | FRAME_FRESH
+  _Alignas(64) atomic_uint cmd_head;
+  _Alignas(64) atomic_uint cmd_tail;
+  command_t commands[RUNNER_COMMANDS];
+  atomic_int state; // c8->state as the emulation thread last saw it
+  sem_t wake;       // posted with every command
+  pthread_t thread;
+  void (*on_frame)(void *ctx); // called from the emulation thread
+  void *ctx;
+  // frontend only
+  uint8_t front;       // slot being shown
+  uint64_t lost;       // commands dropped because the ring was full
+  uint64_t shown;      // frames taken
+  uint64_t dropped;    // frames overwritten before they were taken
+  uint64_t duplicated; // 60Hz slots that showed the previous frame again
+  uint64_t last_seq;
+  uint64_t last_ns;
+} runner_t;
+
+bool start_runner(runner_t *r, chip8_t *c8, scheduler_t *s, config_t config);
+void stop_runner(runner_t *r);
+void runner_command(runner_t *r, command_t cmd);
+emulator_state_t runner_state(runner_t *r);
+const frame_t *runner_frame(runner_t *r);
+void print_frame_stats(const runner_t *r);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <stddef.h>
+
+#include "typedefs.h"
+
+// save state layout, all fields little endian:
+//   magic "C8SS", u16 version, u32 size of the whole state
+//   u64 rom hash, ram (64K), display rows of both planes (u64 left half,
+//   u64 right half), stack (u16), V, schip flags, xo-chip audio pattern,
+//   u16 I, u16 PC, u8 stack depth, u8 delay timer, u8 sound timer,
+//   u8 FX0A key, u8 mode (hires | planes << 1 | xo audio << 3), u8 pitch,
+//   u32 rng state, u64 fnv1a_words checksum of everything before it
+// keys are host input and are not saved
+#define STATE_MAGIC "C8SS"
+#define STATE_VERSION 3
+#define STATE_SIZE                                                             \
+  (4 + 2 + 4 + 8 + RAM_SIZE + 16 * 2 * 64 + 2 * STACK_SIZE + 16 + 16 + 16 +    \
+   2 + 2 + 6 + 4 + 8)
+
+size_t save_state(const chip8_t *c8, uint8_t *buf, size_t cap);
+bool load_state(chip8_t *c8, const uint8_t *buf, size_t len);
+bool save_state_file(const chip8_t *c8, const char *path);
+bool load_state_file(chip8_t *c8, const char *path);
+uint64_t state_hash(const chip8_t *c8);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "engine.h"
+
+#define TIMER_HZ 60       // delay/sound timers and frames
+#define IDLE_SLICE 64     // instructions between idle loop checks
+#define IDLE_WAIT_MS 1000 // longest host sleep while the rom waits on a key
+
+// paces the cpu against a monotonic clock instead of a fixed sleep
+typedef struct Scheduler {
+  engine_t engine;     // executes the instructions
+  uint32_t ips;        // target instructions per second
+  uint32_t budget;     // fractional instructions carried between frames
+  uint32_t pending;    // instructions left in the current frame
+  bool in_frame;       // a frame has been started but not finished
+  bool fast_forward;   // uncapped, only present once per wall frame
+  uint64_t frame_ns;   // length of one 60Hz frame
+  uint64_t next_frame; // absolute deadline of the current frame
+  uint32_t skipped;    // presents skipped in a row while behind
+  uint64_t frames;     // frames completed (timer ticks)
+  uint64_t cycles;     // instructions executed
+  uint64_t resyncs;    // times we fell too far behind and reset the clock
+  bool idle;           // skip idle loops instead of running them
+  uint64_t idled;      // instructions skipped in idle loops, in cycles too
+  uint64_t sleeps;     // host sleeps while the rom waited on a key
+  bool beep;           // the sound timer ran during the last frame
+} scheduler_t;
+
+uint64_t now_ns(void);
+bool init_scheduler(scheduler_t *s, config_t config);
+void free_scheduler(scheduler_t *s);
+uint32_t run_frame(scheduler_t *s, chip8_t *c8, config_t config, uint32_t max);
+bool scheduler_present(scheduler_t *s);
+void scheduler_wait(scheduler_t *s);
+bool scheduler_asleep(const scheduler_t *s, const chip8_t *c8);
+void scheduler_resync(scheduler_t *s);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef SOUND_H
+#define SOUND_H
+
+#include "audio.h"
+#include "frontend.h"
+
+bool init_sound(sdl_t *sdl, audio_t *a);
+#endif
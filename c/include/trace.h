@@ -0,0 +1,44 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "typedefs.h"
+
+// execution trace file, all fields little endian:
+//   magic "C8TR", u16 version, u16 flags (0), u64 rom hash, u64 instructions
+//   traced, u32 records, V0-VF, u16 I and u16 PC after the last record,
+//   records of (u16 PC, u16 opcode, u8 reg, u8 old value, u16 I before),
+//   oldest first, u64 fnv1a checksum of everything before it
+// a record keeps the value a register had before the instruction, so the
+// decoder gets every register back by walking from the final values
+#define TRACE_MAGIC "C8TR"
+#define TRACE_VERSION 1
+#define TRACE_RECORDS (1u << 16) // ring size, a power of two
+#define TRACE_HEADER (4 + 2 + 2 + 8 + 8 + 4 + 16 + 2 + 2)
+#define TRACE_RECORD 8
+
+// reg field: low nibble is the register that changed
+#define TRACE_NONE 0x10 // no register changed
+#define TRACE_MORE 0x20 // another register changed by the record before
+
+typedef struct TraceRecord {
+  uint16_t pc;
+  uint16_t opcode;
+  uint8_t reg; // register index | TRACE_NONE | TRACE_MORE
+  uint8_t old; // its value before the instruction
+  uint16_t I;  // I before the instruction
+} trace_record_t;
+
+typedef struct Trace {
+  trace_record_t *ring;
+  uint64_t records;      // records ever written, the ring keeps the newest
+  uint64_t instructions; // instructions traced
+  const chip8_t *c8;     // for the final registers when flushing
+  const char *path;
+} trace_t;
+
+bool init_trace(trace_t *tr, const chip8_t *c8, const char *path);
+void free_trace(trace_t *tr);
+uint32_t trace_run(trace_t *tr, chip8_t *c8, config_t config, uint32_t n);
+bool flush_trace(const trace_t *tr);
+
+#endif
@@ -1,35 +1,76 @@
 #ifndef TYPEDEFS_H
 #define TYPEDEFS_H
 
-#include "SDL3/SDL.h"
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "quirks.h"
+
 // It's easier to keep everything in collections
+// NOTE: nothing in here may depend on SDL, the core is built without it
+
+// instruction execution engines, see engine.c
+typedef enum EngineKind {
+  ENGINE_SWITCH, // reference decode + switch, emulator()
+  ENGINE_TABLE,  // predecoded 64K handler table
+  ENGINE_BLOCK,  // cached decoded basic blocks
+  ENGINE_JIT,    // x86-64 recompiler, interpreter for the rest
+} engine_kind_t;
 
-// SDL
-typedef struct mSDL {
-  SDL_Window *window;
-  SDL_Renderer *renderer;
-} sdl_t;
+// --capture file formats, see capture.c
+typedef enum CaptureFormat {
+  CAPTURE_RAW,  // a colour index byte per pixel, 8K a frame
+  CAPTURE_Y4M,  // YUV4MPEG2 grey at 60fps, for ffmpeg
+  CAPTURE_APNG, // animated png with the window's palette
+} capture_format_t;
 
 // allows for customizing
 typedef struct Config {
   uint32_t window_width;
   uint32_t window_height;
-  uint32_t fcolor; // fg color RGBA8888
-  uint32_t bcolor; // bg color RGBA8888
-  uint32_t scaler; // scale window size up
+  uint32_t fcolor;        // fg color RGBA8888
+  uint32_t bcolor;        // bg color RGBA8888
+  uint32_t color2;        // xo-chip second plane only RGBA8888
+  uint32_t color3;        // xo-chip both planes RGBA8888
+  uint32_t scaler;        // scale window size up
+  bool headless;          // no window, no rendering, no frame delay
+  uint64_t cycles;        // headless: instructions to run (0 = until QUIT)
+  uint32_t ips;           // instructions per second, timers stay at 60Hz
+  bool fast_forward;      // uncapped, skip rendering
+  engine_kind_t engine;   // how instructions get executed
+  quirk_profile_t quirks; // variant behaviour, see quirks.h
+  bool quirks_given;      // --quirks on the command line, beats the catalog
+  bool ips_given;         // --ips on the command line, beats the catalog
+  char *catalog;          // rom index for quirks/ips (NULL = don't look)
+  uint32_t rewind;        // seconds of rewind history (0 = off)
+  uint32_t seed;          // CXNN rng seed
+  char *record;           // write the keys of every frame here
+  char *replay;           // headless: feed keys from this recording
+  char *profile;          // write PREFIX.txt and PREFIX.folded at exit
+  char *trace;            // instruction trace ring, flushed here
+  bool idle;              // skip idle loops, sleep while waiting on a key
+  uint32_t phosphor;      // % an unlit pixel keeps each frame (0 = off)
+  char *capture;          // write every frame here ("-" = stdout)
+  capture_format_t capture_format;
+  bool capture_block;     // wait for the writer instead of dropping frames
 } config_t;
 
 // chip8 states
 typedef enum EmuState {
-  QUIT,    // shut down
-  RUNNING, // execute
-  PAUSED,  // NOP
-  LOADING, // load data
+  QUIT,      // shut down
+  RUNNING,   // execute
+  PAUSED,    // NOP
+  REWINDING, // step back through the rewind ring
+  LOADING,   // load data
 } emulator_state_t;
 
+// why a rom stopped the machine, state is QUIT once this is set
+typedef enum Fault {
+  FAULT_NONE,
+  FAULT_STACK_OVERFLOW,  // 2NNN with every stack slot taken
+  FAULT_STACK_UNDERFLOW, // 00EE with nothing to return to
+} fault_t;
+
 // opcode defs
 typedef struct Instruction {
   uint16_t opcode;
@@ -40,21 +81,42 @@ typedef struct Instruction {
   uint8_t Y;    // 4 bit reg ID
 } instruction_t;
 
+#define RAM_SIZE 0x10000 // xo-chip, chip8 and schip roms only reach 4K
+#define STACK_SIZE 16     // schip
+
+// one display row, 128 pixels with x 0 in the MSB. lores only uses the top
+// 64 bits of rows 0-31, so a row moves, scrolls or draws as one wide shift
+typedef unsigned __int128 row_t;
+
 // chip8 layout
 typedef struct Chip8 {
-  emulator_state_t state;    // is chip8 running?    4B
-  uint8_t ram[4096];         // chip8 ram            2B
-  bool display[64 * 32];     // original rez         1B
-  uint16_t stack[12];        // subroutines          4B
-  uint8_t V[16];             // data register V0-VF  2B
-  uint16_t I;                // index                4B
-  uint16_t PC;               // program counter      4B
-  uint16_t *SP;              // stack pointer        4B
-  uint8_t delay_timer;       // vx | (60Hz > 0)      2B
-  uint8_t sound_timer;       // ^ will play sound    2B
-  bool keys[16];             // 0x0-0xF              2B
-  char *rom_name;            // current rom          1B
-  instruction_t instruction; // current instruction
+  emulator_state_t state;     // is chip8 running?    4B
+  fault_t fault;              // what stopped it, if the rom did
+  uint8_t ram[RAM_SIZE];      // chip8 ram            2B
+  row_t display[2][64];       // xo-chip bitplanes, 128x64 or 64x32
+  uint64_t dirty_rows;        // display rows changed since last present
+  bool hires;                 // schip 128x64 (00FF) or 64x32 (00FE)
+  uint8_t planes;             // planes DXYN/00E0/scrolls act on (FN01)
+  uint8_t flags[16];          // schip FX75/FX85 persistent registers
+  uint8_t pattern[16];        // xo-chip F002 audio, 1 bit per sample
+  uint8_t pitch;              // xo-chip FX3A, 64 = 4000 samples/s
+  bool xo_audio;              // play pattern instead of the buzzer
+  uint16_t stack[STACK_SIZE]; // subroutines         4B
+  uint8_t V[16];              // data register V0-VF  2B
+  uint16_t I;                 // index                4B
+  uint16_t PC;                // program counter      4B
+  uint16_t *SP;               // stack pointer        4B
+  uint8_t delay_timer;        // vx | (60Hz > 0)      2B
+  uint8_t sound_timer;        // ^ will play sound    2B
+  bool keys[16];              // 0x0-0xF              2B
+  uint8_t wait_key;           // FX0A key held, 0xFF = waiting for a press
+  uint32_t rng;               // CXNN xorshift32 state, never 0
+  char *rom_name;             // current rom          1B
+  uint64_t rom_hash;          // fnv1a of the rom image, names save states
+  instruction_t instruction;  // current instruction
+  uint64_t dirty_pages;       // 64B ram pages written, for decode caches
+  struct Profile *prof;       // sampling profiler, NULL unless --profile
+  struct Trace *trace;        // instruction trace ring, NULL unless --trace
 } chip8_t;
 
 #endif
@@ -1,11 +1,23 @@
 // system
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 // user
+#include "include/catalog.h"
+#include "include/chip8.h"
+#include "include/config.h"
 #include "include/display.h"
 #include "include/emulator.h"
+#include "include/headless.h"
 #include "include/init.h"
 #include "include/input.h"
+#include "include/profile.h"
+#include "include/replay.h"
+#include "include/rewind.h"
+#include "include/runner.h"
+#include "include/scheduler.h"
+#include "include/sound.h"
+#include "include/trace.h"
 
 #ifdef DEBUG
 #include "include/debug.h"
@@ -13,40 +25,132 @@
 
 // shut down emulation
 void cleanup(sdl_t *sdl) {
+  SDL_DestroyAudioStream(sdl->audio); // stops the callback first
+  SDL_DestroyTexture(sdl->texture);
   SDL_DestroyRenderer(sdl->renderer);
   SDL_DestroyWindow(sdl->window);
   SDL_Quit();
 }
 
+// runs on the emulation thread, wakes SDL_WaitEventTimeout() in main()
+static void wake_frontend(void *ctx) {
+  (void)ctx;
+  SDL_Event event = {.type = SDL_EVENT_USER};
+  SDL_PushEvent(&event);
+}
+
 int main(int argc, char **argv) {
   if (argc < 2) {
-    fprintf(stderr, "Usage: %s [rom]\n", argv[0]);
+    fprintf(stderr,
+            "Usage: %s [rom] [--headless] [--cycles N] [--ips N] [--fast] "
+            "[--engine switch|table|block|jit] [--rewind SECONDS] [--seed N] "
+            "[--record FILE] [--replay FILE] [--profile PREFIX] "
+            "[--trace FILE] [--no-idle] [--quirks P] [--catalog FILE] "
+            "[--no-catalog] [--phosphor PERCENT] [--capture FILE] "
+            "[--capture-format raw|y4m|apng] [--capture-block|--capture-drop]"
+            "\n",
+            argv[0]);
     exit(EXIT_FAILURE);
   }
   // inits
   config_t config = {0};
   if (!set_config_args(&config, argc, argv))
     exit(EXIT_FAILURE);
-  sdl_t sdl = {0};
-  if (!init_sdl(&sdl, config))
-    exit(EXIT_FAILURE);
+  apply_catalog(&config, argv[1]);
   chip8_t c8 = {0};
   if (!init_c8(&c8, argv[1]))
     exit(EXIT_FAILURE);
+  seed_c8(&c8, config.seed);
+  if (config.headless) {
+    // no SDL at all
+    return run_headless(&c8, config) ? 0 : EXIT_FAILURE;
+  }
+  sdl_t sdl = {0};
+  if (!init_sdl(&sdl, config))
+    exit(EXIT_FAILURE);
+  SDL_Log("Emulator is now running!");
+  audio_t audio;
+  init_sound(&sdl, &audio); // plays on without it
   // if all above passes
   prep_screen(config, sdl);
+  scheduler_t sched;
+  if (!init_scheduler(&sched, config))
+    exit(EXIT_FAILURE);
+  rewind_t rw = {0};
+  if (config.rewind && !init_rewind(&rw, config.rewind))
+    exit(EXIT_FAILURE);
+  replay_t rp = {0};
+  if (config.record && !init_replay(&rp, &c8, config))
+    exit(EXIT_FAILURE);
+  if (config.profile && !(c8.prof = new_profile()))
+    exit(EXIT_FAILURE);
+  trace_t tr = {0};
+  if (config.trace && !init_trace(&tr, &c8, config.trace))
+    exit(EXIT_FAILURE);
+  if (config.trace)
+    c8.trace = &tr; // F8 writes it on demand
+  capture_t cap;
+  if (config.capture && !start_capture(&cap, config.capture, config))
+    exit(EXIT_FAILURE);
+  // emulation runs on its own thread from here, this one only does SDL
+  runner_t r = {0};
+  r.rw = config.rewind ? &rw : NULL;
+  r.rp = config.record ? &rp : NULL;
+  r.audio = sdl.audio ? &audio : NULL;
+  r.cap = config.capture ? &cap : NULL;
+  r.on_frame = wake_frontend;
+  if (!start_runner(&r, &c8, &sched, config))
+    exit(EXIT_FAILURE);
   // loop
-  // make sure chip8 is done loading AND not shutting down
-  while (c8.state != QUIT && c8.state != LOADING) {
-    input_handler(&c8); // input
-    if (c8.state == PAUSED)
-      continue;                      // is PAUSED, goto top
-    emulator(&c8, config);           // emulation
-    SDL_Delay(16);                   // framerate (60Hz)
-    update_screen(sdl, config, &c8); // display window
+  // the frontend's copy of the display, what update_screen() draws from
+  chip8_t shown = {0};
+  phosphor_t ph;
+  init_phosphor(&ph, config);
+  key_latency_t latency = {0};
+  while (runner_state(&r) != QUIT) {
+    // woken by input or by the emulation thread publishing a frame, and
+    // every frame while pixels are still fading out
+    SDL_WaitEventTimeout(NULL, ph.fading ? 1000 / TIMER_HZ : IDLE_WAIT_MS);
+    uint64_t t = now_ns(); // profiler clock, waiting is charged over there
+    input_handler(&shown, &r); // input
+    profile_time(c8.prof, PROF_INPUT, &t);
+    const frame_t *frame = runner_frame(&r);
+    if (frame) {
+      memcpy(shown.display, frame->display, sizeof shown.display);
+      shown.hires = frame->hires;
+      shown.dirty_rows |= frame->dirty_rows;
+    }
+    update_screen(sdl, &ph, &shown); // display window
+    if (frame)
+      key_presented(&latency, frame->pressed, frame->n_pressed, now_ns());
+    profile_time(c8.prof, PROF_RENDER, &t);
   }
+  stop_runner(&r); // c8 is ours again
+  if (c8.fault)
+    SDL_Log("%s stopped by %s at 0x%03X", c8.rom_name, fault_name(c8.fault),
+            c8.PC - 2);
+  if (config.capture)
+    stop_capture(&cap); // writes out what is still queued
 
   // close
+  if (config.record && save_replay(&rp, config.record))
+    SDL_Log("Recorded %u frames to %s", rp.frames, config.record);
+  free_replay(&rp);
+  if (c8.prof && write_profile(c8.prof, &c8, config.profile))
+    SDL_Log("Profile written to %s.txt and %s.folded", config.profile,
+            config.profile);
+  free_profile(c8.prof);
+  if (c8.trace && flush_trace(c8.trace))
+    SDL_Log("Trace written to %s", config.trace);
+  free_trace(&tr);
+  print_rewind_stats(&rw);
+  print_key_latency(&latency);
+  print_frame_stats(&r);
+  if (config.capture)
+    print_capture_stats(&cap);
+  free_rewind(&rw);
+  free_scheduler(&sched);
   cleanup(&sdl);
+  print_audio_stats(&audio);
   return 0;
 }
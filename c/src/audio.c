@@ -0,0 +1,99 @@
+#include "../include/audio.h"
+#include "../include/scheduler.h"
+#include <stdio.h>
+
+void init_audio(audio_t *a) {
+  *a = (audio_t){
+      .step = (uint32_t)(((uint64_t)AUDIO_TONE << 16) / AUDIO_RATE),
+  };
+  atomic_init(&a->head, 0);
+  atomic_init(&a->tail, 0);
+}
+
+// pattern bits per sample in 16.16, PATTERN_RATE * 2^((pitch - 64) / 48).
+// a semitone is 4 steps, so stepping by 2^(1/48) is exact enough
+static uint32_t pattern_step(const uint8_t pitch) {
+  double rate = PATTERN_RATE;
+  for (int p = 64; p < pitch; p++)
+    rate *= 1.0145453349375237; // 2^(1/48)
+  for (int p = pitch; p < 64; p++)
+    rate /= 1.0145453349375237;
+  return (uint32_t)(rate * 65536 / AUDIO_RATE);
+}
+
+// queue one frame (1/60s) of buzzer, beep is whether the sound timer was
+// running. once the rom loaded an xo-chip pattern (F002) that is played
+// instead of the square wave. emulation thread only
+void audio_frame(audio_t *a, const bool beep, const chip8_t *c8) {
+  const uint32_t n = (AUDIO_RATE + a->carry) / TIMER_HZ;
+  const bool pattern = c8->xo_audio;
+  const uint32_t bit_step = pattern ? pattern_step(c8->pitch) : 0;
+  a->carry = (AUDIO_RATE + a->carry) % TIMER_HZ;
+
+  // the consumer only moves head forward, so free space can only grow
+  const uint32_t tail = atomic_load_explicit(&a->tail, memory_order_relaxed);
+  const uint32_t head = atomic_load_explicit(&a->head, memory_order_acquire);
+  const uint32_t queued = tail - head;
+  const uint32_t room = queued < AUDIO_QUEUE ? AUDIO_QUEUE - queued : 0;
+  const uint32_t fit = n < room ? n : room;
+  for (uint32_t i = 0; i < fit; i++) {
+    bool high;
+    if (pattern) {
+      const uint32_t b = a->bit >> 16; // msb of pattern[0] first
+      high = c8->pattern[b >> 3] >> (7 - (b & 7)) & 1;
+      a->bit = (a->bit + bit_step) & ((128u << 16) - 1);
+    } else {
+      high = !(a->phase & 0x8000); // high for the first half of the period
+      a->phase = (a->phase + a->step) & 0xFFFF;
+    }
+    const int16_t s = beep ? (high ? AUDIO_VOLUME : -AUDIO_VOLUME) : 0;
+    a->ring[(tail + i) & (AUDIO_RING - 1)] = s;
+  }
+  atomic_store_explicit(&a->tail, tail + fit, memory_order_release);
+  a->produced += fit;
+  if (fit < n) {
+    a->dropped += n - fit; // the device is behind, keep latency bounded
+    a->overruns++;
+  }
+}
+
+// fill out with n samples, silence for whatever is missing. audio
+// callback only
+void audio_pull(audio_t *a, int16_t *out, const uint32_t n) {
+  const uint32_t head = atomic_load_explicit(&a->head, memory_order_relaxed);
+  const uint32_t tail = atomic_load_explicit(&a->tail, memory_order_acquire);
+  const uint32_t queued = tail - head;
+  const uint32_t got = queued < n ? queued : n;
+  for (uint32_t i = 0; i < got; i++)
+    out[i] = a->ring[(head + i) & (AUDIO_RING - 1)];
+  atomic_store_explicit(&a->head, head + got, memory_order_release);
+
+  if (got)
+    a->last = out[got - 1];
+  if (got < n) {
+    if (a->last != 0)
+      a->underruns++; // a tone was cut off, audible
+    for (uint32_t i = got; i < n; i++)
+      out[i] = 0;
+    a->starved += n - got;
+    a->last = 0;
+  }
+  a->played += n;
+  a->pulls++;
+  a->queued_sum += queued;
+  if (queued > a->queued_max)
+    a->queued_max = queued;
+}
+
+void print_audio_stats(const audio_t *a) {
+  if (a->pulls == 0)
+    return;
+  printf("audio: %llu samples played, %llu underruns (%.1fms silence), "
+         "%llu overruns (%llu samples dropped), queue %.2fms mean, %.2fms "
+         "max\n",
+         (unsigned long long)a->played, (unsigned long long)a->underruns,
+         a->starved * 1e3 / AUDIO_RATE, (unsigned long long)a->overruns,
+         (unsigned long long)a->dropped,
+         (double)a->queued_sum / a->pulls * 1e3 / AUDIO_RATE,
+         a->queued_max * 1e3 / AUDIO_RATE);
+}
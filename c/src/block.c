@@ -0,0 +1,91 @@
+#include "../include/block.h"
+#include "../include/dispatch.h"
+#include <stdlib.h>
+
+block_cache_t *new_block_cache(void) {
+  return calloc(1, sizeof(block_cache_t));
+}
+
+void free_block_cache(block_cache_t *bc) {
+  if (!bc)
+    return;
+  for (uint32_t i = 0; i < CODE_SIZE; i++)
+    free(bc->blocks[i]);
+  free(bc);
+}
+
+// drop every block decoded from one of the given pages. a block can start
+// up to BLOCK_MAX ops before a page it reaches into, so only that window is
+// scanned. code_pages stays a superset, it only gates the scan
+void invalidate_blocks(block_cache_t *bc, uint64_t pages) {
+  pages &= bc->code_pages; // data writes (scores, BCD) stop here
+  while (pages) {
+    const uint32_t page = __builtin_ctzll(pages);
+    pages &= pages - 1;
+    const int32_t first = (int32_t)(page << RAM_PAGE_SHIFT) - 2 * BLOCK_MAX;
+    const uint32_t last = (page + 1) << RAM_PAGE_SHIFT;
+    for (uint32_t pc = first < 0 ? 0 : first; pc < last; pc++) {
+      block_t *b = bc->blocks[pc];
+      if (b && b->valid && (b->pages & (1ull << page))) {
+        b->valid = false;
+        bc->invalidations++;
+      }
+    }
+  }
+}
+
+// decode from pc until something that branches or writes ram
+static void decode_block(block_cache_t *bc, block_t *b, const chip8_t *c8,
+                         const op_fn *table, uint16_t pc) {
+  b->len = 0;
+  b->pages = 0;
+  while (b->len < BLOCK_MAX && pc + 1u < CODE_SIZE) {
+    const uint16_t op = fetch(c8, pc);
+    b->fn[b->len] = table[op];
+    b->op[b->len] = op;
+    b->len++;
+    b->pages |= 1ull << (pc >> RAM_PAGE_SHIFT);
+    b->pages |= 1ull << ((pc + 1) >> RAM_PAGE_SHIFT);
+    pc += 2;
+    if (op_ends_block(op))
+      break;
+  }
+  b->valid = true;
+  bc->code_pages |= b->pages;
+}
+
+// run up to n instructions a block at a time
+uint32_t block_run(block_cache_t *bc, chip8_t *c8, const config_t config,
+                   const uint32_t n) {
+  uint32_t executed = 0;
+  while (executed < n && c8->state == RUNNING) {
+    if (c8->dirty_pages) {
+      invalidate_blocks(bc, c8->dirty_pages);
+      c8->dirty_pages = 0;
+    }
+    if (c8->PC + 1u >= CODE_SIZE) {
+      // past the 4K blocks cover (xo-chip), let the table engine run it
+      executed += dispatch_run(c8, config, 1);
+      continue;
+    }
+
+    block_t *b = bc->blocks[c8->PC];
+    if (b && b->valid) {
+      bc->hits++;
+    } else {
+      bc->misses++;
+      if (!b && !(b = bc->blocks[c8->PC] = malloc(sizeof(block_t))))
+        return executed + dispatch_run(c8, config, n - executed);
+      decode_block(bc, b, c8, op_table[config.quirks], c8->PC);
+    }
+
+    // budget may run out mid block, the rest starts a new block next time
+    const uint32_t len = b->len < n - executed ? b->len : n - executed;
+    for (uint32_t i = 0; i < len && c8->state == RUNNING; i++) {
+      c8->PC += 2;
+      b->fn[i](c8, &config, b->op[i]);
+      executed++;
+    }
+  }
+  return executed;
+}
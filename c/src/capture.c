@@ -0,0 +1,362 @@
+#include "../include/capture.h"
+#include "../include/scheduler.h"
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+static const char *const names[] = {
+    [CAPTURE_RAW] = "raw",
+    [CAPTURE_Y4M] = "y4m",
+    [CAPTURE_APNG] = "apng",
+};
+
+static const char *const extensions[] = {
+    [CAPTURE_RAW] = "raw",
+    [CAPTURE_Y4M] = "y4m",
+    [CAPTURE_APNG] = "png",
+};
+
+const char *capture_format_name(const capture_format_t format) {
+  return names[format];
+}
+
+const char *capture_extension(const capture_format_t format) {
+  return extensions[format];
+}
+
+bool parse_capture_format(const char *name, capture_format_t *format) {
+  for (uint32_t i = 0; i < sizeof names / sizeof names[0]; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      *format = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// by extension, raw for anything else (and stdout)
+capture_format_t capture_format_for(const char *path) {
+  const char *dot = strrchr(path, '.');
+  if (dot && strcasecmp(dot, ".y4m") == 0)
+    return CAPTURE_Y4M;
+  if (dot && (strcasecmp(dot, ".png") == 0 || strcasecmp(dot, ".apng") == 0))
+    return CAPTURE_APNG;
+  return CAPTURE_RAW;
+}
+
+static uint32_t crc_table[256];
+
+static void build_crc_table(void) {
+  for (uint32_t n = 0; n < 256; n++) {
+    uint32_t c = n;
+    for (int k = 0; k < 8; k++)
+      c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    crc_table[n] = c;
+  }
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t *p, const size_t n) {
+  crc = ~crc;
+  for (size_t i = 0; i < n; i++)
+    crc = crc_table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+static void put_be32(uint8_t *p, const uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static void put_be16(uint8_t *p, const uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v;
+}
+
+static void put(capture_t *c, const void *data, const size_t n) {
+  if (!c->failed && n && fwrite(data, 1, n, c->out) != n)
+    c->failed = true;
+}
+
+// length, type, data, crc of type and data
+static void put_chunk(capture_t *c, const char type[4], const uint8_t *data,
+                      const uint32_t n) {
+  uint8_t head[8], crc[4];
+  put_be32(head, n);
+  memcpy(head + 4, type, 4);
+  put_be32(crc, crc32(crc32(0, head + 4, 4), data, n));
+  put(c, head, sizeof head);
+  put(c, data, n);
+  put(c, crc, sizeof crc);
+}
+
+// acTL: frame count, play forever
+static void put_actl(capture_t *c, const uint32_t frames) {
+  uint8_t actl[8] = {0};
+  put_be32(actl, frames);
+  put_chunk(c, "acTL", actl, sizeof actl);
+}
+
+static void put_header(capture_t *c) {
+  if (c->format == CAPTURE_Y4M) {
+    char head[64];
+    const int n = snprintf(head, sizeof head,
+                           "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 Cmono\n",
+                           DISPLAY_WIDTH, DISPLAY_HEIGHT, TIMER_HZ);
+    put(c, head, n);
+  } else if (c->format == CAPTURE_APNG) {
+    static const uint8_t signature[8] = {0x89, 'P',  'N',  'G',
+                                         '\r', '\n', 0x1A, '\n'};
+    uint8_t ihdr[13] = {0};
+    put_be32(ihdr, DISPLAY_WIDTH);
+    put_be32(ihdr + 4, DISPLAY_HEIGHT);
+    ihdr[8] = 8; // bits per index
+    ihdr[9] = 3; // palette
+    put(c, signature, sizeof signature);
+    put_chunk(c, "IHDR", ihdr, sizeof ihdr);
+    put_chunk(c, "PLTE", &c->palette[0][0], sizeof c->palette);
+    c->actl = ftell(c->out);
+    put_actl(c, 0); // patched by stop_capture()
+  }
+}
+
+// the held frame, shown for ticks 60Hz frames: a y4m repeats it, an apng
+// stretches its delay and raw has it once
+static void put_frame(capture_t *c, const uint64_t ticks) {
+  if (c->failed)
+    return;
+  if (c->format == CAPTURE_RAW) {
+    put(c, c->image, sizeof c->image);
+    c->written++;
+  } else if (c->format == CAPTURE_Y4M) {
+    uint8_t luma[4];
+    for (int i = 0; i < 4; i++) // full range, BT.601 weights
+      luma[i] = (77 * c->palette[i][0] + 150 * c->palette[i][1] +
+                 29 * c->palette[i][2]) >>
+                8;
+    uint8_t y[DISPLAY_HEIGHT][DISPLAY_WIDTH];
+    for (uint32_t r = 0; r < DISPLAY_HEIGHT; r++)
+      for (uint32_t x = 0; x < DISPLAY_WIDTH; x++)
+        y[r][x] = luma[c->image[r][x]];
+    for (uint64_t t = 0; t < ticks; t++) {
+      put(c, "FRAME\n", 6);
+      put(c, y, sizeof y);
+      c->written++;
+    }
+  } else {
+    uint8_t fctl[26] = {0};
+    put_be32(fctl, c->png_seq++);
+    put_be32(fctl + 4, DISPLAY_WIDTH);
+    put_be32(fctl + 8, DISPLAY_HEIGHT);
+    put_be16(fctl + 20, ticks > 0xFFFF ? 0xFFFF : ticks); // delay / 60s
+    put_be16(fctl + 22, TIMER_HZ);
+    put_chunk(c, "fcTL", fctl, sizeof fctl);
+
+    // zlib stream of one stored deflate block, no compressor needed
+    uint8_t *p = c->png + 4;
+    p[0] = 0x78;
+    p[1] = 0x01;
+    p[2] = 1; // final, stored
+    p[3] = CAPTURE_PNG_DATA & 0xFF;
+    p[4] = CAPTURE_PNG_DATA >> 8;
+    p[5] = ~CAPTURE_PNG_DATA & 0xFF;
+    p[6] = ~CAPTURE_PNG_DATA >> 8 & 0xFF;
+    uint8_t *data = p + 7;
+    uint32_t a = 1, b = 0; // adler32, a row is far from overflowing b
+    for (uint32_t r = 0; r < DISPLAY_HEIGHT; r++) {
+      *data++ = 0; // no filter
+      b += a;
+      for (uint32_t x = 0; x < DISPLAY_WIDTH; x++) {
+        a += data[x] = c->image[r][x];
+        b += a;
+      }
+      data += DISPLAY_WIDTH;
+      a %= 65521;
+      b %= 65521;
+    }
+    put_be32(data, b << 16 | a);
+    if (c->written == 0) {
+      put_chunk(c, "IDAT", p, sizeof c->png - 4);
+    } else {
+      put_be32(c->png, c->png_seq++);
+      put_chunk(c, "fdAT", c->png, sizeof c->png);
+    }
+    c->written++;
+  }
+}
+
+// colour indices at 128x64, lores pixels doubled
+static void expand(capture_t *c, const capture_slot_t *s) {
+  const uint32_t scale = s->hires ? 1 : 2;
+  for (uint32_t y = 0; y < DISPLAY_HEIGHT; y++) {
+    uint8_t *dst = c->image[y];
+    for (uint32_t half = 0; half < 2 / scale; half++) {
+      // a 64 pixel word per plane, x 0 in the MSB
+      const uint32_t at = 64 * (1 - half);
+      const uint64_t p1 = s->display[0][y / scale] >> at;
+      const uint64_t p2 = s->display[1][y / scale] >> at;
+      for (int bit = 63; bit >= 0; bit--) {
+        const uint8_t v = (p1 >> bit & 1) | (p2 >> bit & 1) << 1;
+        for (uint32_t k = 0; k < scale; k++)
+          *dst++ = v;
+      }
+    }
+  }
+}
+
+// the writer thread: a frame is held until the next one comes in, so the
+// gap left by dropped frames is known when it is written
+static void *write_frames(void *arg) {
+  capture_t *c = arg;
+  for (;;) {
+    const uint32_t head = atomic_load_explicit(&c->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&c->tail, memory_order_acquire)) {
+      // done is set after the last frame, so seeing it means seeing that
+      if (atomic_load_explicit(&c->done, memory_order_acquire) &&
+          head == atomic_load_explicit(&c->tail, memory_order_acquire))
+        break;
+      sem_wait(&c->wake);
+      continue;
+    }
+    const capture_slot_t *s = &c->slots[head & (CAPTURE_SLOTS - 1)];
+    if (c->holding)
+      put_frame(c, s->seq - c->image_seq);
+    expand(c, s);
+    c->image_seq = s->seq;
+    c->holding = true;
+    atomic_store_explicit(&c->head, head + 1, memory_order_release);
+    if (c->block)
+      sem_post(&c->room);
+  }
+  // the producer is finished with seq, the last frame lasts until the end
+  if (c->holding)
+    put_frame(c, c->seq - c->image_seq);
+  return NULL;
+}
+
+// "-" writes to stdout and moves everything printed there to stderr, so
+// the stream can be piped straight into ffmpeg
+bool start_capture(capture_t *c, const char *path, const config_t config) {
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, build_crc_table);
+  memset(c, 0, sizeof *c);
+  c->path = path;
+  c->format = config.capture_format;
+  c->block = config.capture_block;
+  const uint32_t colors[4] = {config.bcolor, config.fcolor, config.color2,
+                              config.color3};
+  for (int i = 0; i < 4; i++) { // RGBA8888
+    c->palette[i][0] = colors[i] >> 24;
+    c->palette[i][1] = colors[i] >> 16;
+    c->palette[i][2] = colors[i] >> 8;
+  }
+
+  if (strcmp(path, "-") == 0) {
+    const int fd = dup(STDOUT_FILENO);
+    fflush(stdout);
+    if (fd < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0 ||
+        !(c->out = fdopen(fd, "wb"))) {
+      fprintf(stderr, "Failed to capture to stdout.\n");
+      return false;
+    }
+    signal(SIGPIPE, SIG_IGN); // a reader that quits ends the capture only
+  } else if (!(c->out = fopen(path, "wb"))) {
+    fprintf(stderr, "Failed to open %s.\n", path);
+    return false;
+  }
+  if (c->format == CAPTURE_APNG && fseek(c->out, 0, SEEK_CUR) != 0) {
+    fprintf(stderr, "An apng needs a seekable file, %s is a pipe. Use "
+                    "--capture-format y4m or raw.\n",
+            path);
+    fclose(c->out);
+    return false;
+  }
+  put_header(c);
+
+  c->slots = malloc(CAPTURE_SLOTS * sizeof *c->slots);
+  atomic_init(&c->head, 0);
+  atomic_init(&c->tail, 0);
+  atomic_init(&c->done, false);
+  if (!c->slots || sem_init(&c->wake, 0, 0) != 0) {
+    fprintf(stderr, "Failed to set up the capture.\n");
+    free(c->slots);
+    fclose(c->out);
+    return false;
+  }
+  if (sem_init(&c->room, 0, 0) != 0 ||
+      pthread_create(&c->thread, NULL, write_frames, c) != 0) {
+    fprintf(stderr, "Failed to start the capture thread!\n");
+    sem_destroy(&c->wake);
+    sem_destroy(&c->room);
+    free(c->slots);
+    fclose(c->out);
+    return false;
+  }
+  return true;
+}
+
+// emulation thread, once per finished frame: copy the display into the
+// next free slot. a full queue drops the frame, or waits with block
+void capture_frame(capture_t *c, const chip8_t *c8) {
+  uint64_t start = now_ns();
+  const uint32_t tail = atomic_load_explicit(&c->tail, memory_order_relaxed);
+  if (tail - atomic_load_explicit(&c->head, memory_order_acquire) ==
+      CAPTURE_SLOTS) {
+    if (!c->block) {
+      c->dropped++;
+      c->seq++;
+      c->copy_ns += now_ns() - start;
+      return;
+    }
+    c->stalls++;
+    do
+      sem_wait(&c->room);
+    while (tail - atomic_load_explicit(&c->head, memory_order_acquire) ==
+           CAPTURE_SLOTS);
+    const uint64_t room = now_ns();
+    c->stall_ns += room - start;
+    start = room;
+  }
+  capture_slot_t *s = &c->slots[tail & (CAPTURE_SLOTS - 1)];
+  memcpy(s->display, c8->display, sizeof s->display);
+  s->hires = c8->hires;
+  s->seq = c->seq++;
+  atomic_store_explicit(&c->tail, tail + 1, memory_order_release);
+  sem_post(&c->wake);
+  c->copy_ns += now_ns() - start;
+}
+
+// write out what is queued, finish the file and close it. false if any
+// of it could not be written
+bool stop_capture(capture_t *c) {
+  atomic_store_explicit(&c->done, true, memory_order_release);
+  sem_post(&c->wake);
+  pthread_join(c->thread, NULL);
+  if (c->format == CAPTURE_APNG) {
+    put_chunk(c, "IEND", c->png, 0);
+    if (!c->failed && fseek(c->out, c->actl, SEEK_SET) == 0)
+      put_actl(c, c->written);
+  }
+  if (fclose(c->out) != 0)
+    c->failed = true;
+  sem_destroy(&c->wake);
+  sem_destroy(&c->room);
+  free(c->slots);
+  c->slots = NULL;
+  if (c->failed)
+    fprintf(stderr, "Capture to %s failed, it is incomplete.\n", c->path);
+  return !c->failed;
+}
+
+void print_capture_stats(const capture_t *c) {
+  if (c->seq == 0)
+    return;
+  printf("capture: %llu frames to %s (%s), %llu dropped, %.2fus a frame on "
+         "the emulation thread, %llu stalls (%.3fs)\n",
+         (unsigned long long)c->written, c->path, names[c->format],
+         (unsigned long long)c->dropped, c->copy_ns / 1e3 / c->seq,
+         (unsigned long long)c->stalls, c->stall_ns / 1e9);
+}
@@ -0,0 +1,438 @@
+#include "../include/catalog.h"
+#include "../include/chip8.h"
+#include "../include/hash.h"
+#include "../include/ops.h"
+#include "../include/pool.h"
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#define ROM_START 0x200 // where load_c8 puts the rom
+
+static const char *const platform_names[] = {
+#define X(id, name, ...) [PLATFORM_##id] = #name,
+    PLATFORMS(X)
+#undef X
+};
+
+static const quirk_profile_t platform_quirks[] = {
+#define X(id, name, quirks, ips) [PLATFORM_##id] = quirks,
+    PLATFORMS(X)
+#undef X
+};
+
+static const uint32_t platform_ips[] = {
+#define X(id, name, quirks, ips) [PLATFORM_##id] = ips,
+    PLATFORMS(X)
+#undef X
+};
+
+const char *platform_name(const platform_t platform) {
+  return platform_names[platform];
+}
+
+static bool parse_platform(const char *name, platform_t *platform) {
+  for (uint32_t i = 0; i < PLATFORM_COUNT; i++) {
+    if (strcmp(name, platform_names[i]) == 0) {
+      *platform = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// the opcode at addr, or 0 when addr is outside the rom
+static uint16_t rom_op(const uint8_t *rom, const size_t size,
+                       const uint32_t addr) {
+  if (addr < ROM_START || addr + 1 - ROM_START >= size)
+    return 0;
+  return rom[addr - ROM_START] << 8 | rom[addr + 1 - ROM_START];
+}
+
+// the newest instruction set op belongs to
+static platform_t op_platform(const uint16_t op) {
+  const uint8_t nn = OP_NN(op), x = OP_X(op);
+  switch (op >> 12) {
+  case 0x0:
+    if (op == 0x00FB || op == 0x00FC || op == 0x00FD || op == 0x00FE ||
+        op == 0x00FF || (op & 0xFFF0) == 0x00C0)
+      return PLATFORM_SCHIP;
+    return (op & 0xFFF0) == 0x00D0 ? PLATFORM_XOCHIP : PLATFORM_CHIP8;
+  case 0x5:
+    return OP_N(op) == 2 || OP_N(op) == 3 ? PLATFORM_XOCHIP : PLATFORM_CHIP8;
+  case 0xD:
+    return OP_N(op) == 0 ? PLATFORM_SCHIP : PLATFORM_CHIP8;
+  case 0xF:
+    if (op == 0xF000 || nn == 0x01 || nn == 0x02 || nn == 0x3A)
+      return PLATFORM_XOCHIP;
+    if (nn == 0x30 || nn == 0x75 || nn == 0x85)
+      return x > 7 ? PLATFORM_XOCHIP : PLATFORM_SCHIP; // schip has 8 flags
+    return PLATFORM_CHIP8;
+  }
+  return PLATFORM_CHIP8;
+}
+
+// follow the code from the entry point through jumps, calls and both
+// sides of every skip, so sprite data that happens to look like 00FF is
+// never decoded. BNNN tables are followed from their first entry
+static platform_t walk_code(const uint8_t *rom, const size_t size) {
+  uint8_t *seen = calloc(RAM_SIZE / 8, 1);
+  uint16_t *todo = malloc(RAM_SIZE * sizeof *todo);
+  platform_t platform = PLATFORM_CHIP8;
+  if (!seen || !todo) {
+    free(seen);
+    free(todo);
+    return platform;
+  }
+  uint32_t n = 0;
+#define PUSH(a)                                                                \
+  do {                                                                         \
+    const uint16_t at = (a);                                                   \
+    if (!(seen[at >> 3] & (1u << (at & 7)))) {                                 \
+      seen[at >> 3] |= 1u << (at & 7);                                         \
+      todo[n++] = at;                                                          \
+    }                                                                          \
+  } while (0)
+
+  PUSH(ROM_START);
+  while (n) {
+    const uint16_t pc = todo[--n];
+    if (pc < ROM_START || pc + 1u - ROM_START >= size)
+      continue; // left the rom, nothing known out there
+    const uint16_t op = rom_op(rom, size, pc);
+    const platform_t p = op_platform(op);
+    if (p > platform)
+      platform = p;
+    const uint16_t next = pc + 2;
+    const uint16_t skip = rom_op(rom, size, next) == 0xF000 ? 4 : 2;
+    switch (op >> 12) {
+    case 0x0:
+      if (op != 0x00EE && op != 0x00FD)
+        PUSH(next);
+      break;
+    case 0x1:
+      PUSH(OP_NNN(op));
+      break;
+    case 0x2:
+      PUSH(OP_NNN(op));
+      PUSH(next);
+      break;
+    case 0x3:
+    case 0x4:
+    case 0x9:
+      PUSH(next);
+      PUSH(next + skip);
+      break;
+    case 0x5:
+      PUSH(next);
+      if (OP_N(op) == 0)
+        PUSH(next + skip);
+      break;
+    case 0xB:
+      PUSH(OP_NNN(op));
+      break;
+    case 0xE:
+      PUSH(next);
+      if (OP_NN(op) == 0x9E || OP_NN(op) == 0xA1)
+        PUSH(next + skip);
+      break;
+    case 0xF:
+      PUSH(op == 0xF000 ? next + 2 : next);
+      break;
+    default:
+      PUSH(next);
+      break;
+    }
+  }
+#undef PUSH
+  free(seen);
+  free(todo);
+  return platform;
+}
+
+// hash and suggested settings for a rom image
+void guess_rom(catalog_entry_t *e, const uint8_t *rom, const size_t size) {
+  e->size = size;
+  e->hash = fnv1a(FNV_OFFSET, rom, size);
+  e->platform = walk_code(rom, size);
+  if (size > CODE_SIZE - ROM_START)
+    e->platform = PLATFORM_XOCHIP; // only xo-chip has ram past 4K
+  e->quirks = platform_quirks[e->platform];
+  e->ips = platform_ips[e->platform];
+}
+
+static int by_path(const void *a, const void *b) {
+  return strcmp(((const catalog_entry_t *)a)->path,
+                ((const catalog_entry_t *)b)->path);
+}
+
+static bool push_entry(catalog_t *cat, uint32_t *cap,
+                       const catalog_entry_t e) {
+  if (cat->n == *cap) {
+    *cap = *cap ? *cap * 2 : 256;
+    catalog_entry_t *grown = realloc(cat->entries, *cap * sizeof e);
+    if (!grown)
+      return false;
+    cat->entries = grown;
+  }
+  cat->entries[cat->n++] = e;
+  return true;
+}
+
+// a missing index is an empty one, the first scan fills it. an index
+// written by another version is dropped the same way
+bool load_catalog(catalog_t *cat, const char *path) {
+  *cat = (catalog_t){0};
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return true;
+  char line[4096];
+  uint32_t cap = 0;
+  bool ok = true;
+  if (!fgets(line, sizeof line, f) ||
+      strncmp(line, CATALOG_HEADER "\n", sizeof CATALOG_HEADER) != 0) {
+    fprintf(stderr, "%s is not a catalog of this version, rescanning.\n",
+            path);
+    fclose(f);
+    return true;
+  }
+  while (ok && fgets(line, sizeof line, f)) {
+    if (line[0] == '#')
+      continue;
+    catalog_entry_t e = {0};
+    char platform[16], quirks[16];
+    int at = 0;
+    if (sscanf(line,
+               "%" SCNx64 "\t%" SCNu64 "\t%" SCNd64 "\t%15s\t%15s"
+               "\t%" SCNu32 "\t%n",
+               &e.hash, &e.size, &e.mtime, platform, quirks, &e.ips,
+               &at) < 6 ||
+        !at || !parse_platform(platform, &e.platform) ||
+        !parse_quirks(quirks, &e.quirks))
+      continue; // damaged line, the scan finds the rom again
+    line[strcspn(line, "\n")] = '\0';
+    ok = (e.path = strdup(line + at)) && push_entry(cat, &cap, e);
+  }
+  fclose(f);
+  if (!ok) {
+    fprintf(stderr, "Out of memory loading %s.\n", path);
+    free_catalog(cat);
+    return false;
+  }
+  qsort(cat->entries, cat->n, sizeof *cat->entries, by_path);
+  return true;
+}
+
+// written next to the old one and renamed over it, so a crash never
+// leaves half an index
+bool save_catalog(const catalog_t *cat, const char *path) {
+  char tmp[4096];
+  snprintf(tmp, sizeof tmp, "%s.tmp", path);
+  FILE *f = fopen(tmp, "w");
+  if (!f) {
+    fprintf(stderr, "Failed to open %s.\n", tmp);
+    return false;
+  }
+  fprintf(f, CATALOG_HEADER "\n# hash\tsize\tmtime\tplatform\tquirks\tips"
+             "\tpath\n");
+  for (uint32_t i = 0; i < cat->n; i++) {
+    const catalog_entry_t *e = &cat->entries[i];
+    fprintf(f, "%016" PRIx64 "\t%" PRIu64 "\t%" PRId64 "\t%s\t%s\t%u\t%s\n",
+            e->hash, e->size, e->mtime, platform_name(e->platform),
+            quirks_name(e->quirks), e->ips, e->path);
+  }
+  bool ok = !ferror(f);
+  ok &= fclose(f) == 0;
+  if (ok && rename(tmp, path) != 0)
+    ok = false;
+  if (!ok) {
+    fprintf(stderr, "Could not write catalog %s.\n", path);
+    remove(tmp);
+  }
+  return ok;
+}
+
+static bool is_rom(const char *name) {
+  static const char *const exts[] = {".ch8", ".c8", ".sc8", ".xo8"};
+  const char *dot = strrchr(name, '.');
+  for (uint32_t i = 0; dot && i < sizeof exts / sizeof exts[0]; i++)
+    if (strcasecmp(dot, exts[i]) == 0)
+      return true;
+  return false;
+}
+
+// every rom under dir into found, hidden files and directories skipped.
+// paths with a tab or newline can't go in the index and are left out
+static bool walk_dir(const char *dir, catalog_t *found, uint32_t *cap) {
+  DIR *d = opendir(dir);
+  if (!d)
+    return true; // gone or unreadable, not worth failing the scan
+  bool ok = true;
+  struct dirent *de;
+  while (ok && (de = readdir(d))) {
+    if (de->d_name[0] == '.')
+      continue;
+    char path[4096];
+    if ((size_t)snprintf(path, sizeof path, "%s/%s", dir, de->d_name) >=
+            sizeof path ||
+        strpbrk(path, "\t\n"))
+      continue;
+    struct stat st;
+    if (stat(path, &st) != 0)
+      continue;
+    if (S_ISDIR(st.st_mode)) {
+      ok = walk_dir(path, found, cap);
+    } else if (S_ISREG(st.st_mode) && is_rom(de->d_name) &&
+               (size_t)st.st_size <= RAM_SIZE - ROM_START) {
+      const catalog_entry_t e = {
+          .size = st.st_size,
+          .mtime = st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec,
+      };
+      ok = push_entry(found, cap, e) &&
+           (found->entries[found->n - 1].path = strdup(path));
+    }
+  }
+  closedir(d);
+  return ok;
+}
+
+typedef struct Scan {
+  catalog_entry_t *entries;
+  uint32_t *jobs; // entries to hash
+  bool *failed;   // by job
+} scan_t;
+
+static void hash_job(void *ctx, const uint32_t job, const uint32_t worker) {
+  (void)worker;
+  scan_t *s = ctx;
+  catalog_entry_t *e = &s->entries[s->jobs[job]];
+  size_t size = 0;
+  const uint8_t *rom = map_rom(e->path, &size);
+  if (!rom) {
+    s->failed[job] = true;
+    return;
+  }
+  guess_rom(e, rom, size);
+  unmap_rom(rom, size);
+}
+
+// bring the index in line with dirs: entries whose size and mtime still
+// match are kept as they are, new and changed roms are hashed on threads
+// workers (0 = every core) and roms that went away are dropped
+bool scan_catalog(catalog_t *cat, char *const *dirs, const uint32_t n_dirs,
+                  const uint32_t threads) {
+  catalog_t found = {0};
+  uint32_t cap = 0;
+  bool ok = true;
+  for (uint32_t i = 0; ok && i < n_dirs; i++)
+    ok = walk_dir(dirs[i], &found, &cap);
+  if (ok)
+    qsort(found.entries, found.n, sizeof *found.entries, by_path);
+
+  scan_t s = {
+      .entries = found.entries,
+      .jobs = malloc((found.n + 1) * sizeof *s.jobs),
+      .failed = calloc(found.n + 1, sizeof *s.failed),
+  };
+  ok &= s.jobs && s.failed;
+  uint32_t n_jobs = 0;
+  for (uint32_t i = 0; ok && i < found.n; i++) {
+    catalog_entry_t *e = &found.entries[i];
+    const catalog_entry_t *old =
+        bsearch(e, cat->entries, cat->n, sizeof *e, by_path);
+    if (old && old->size == e->size && old->mtime == e->mtime) {
+      char *path = e->path;
+      *e = *old;
+      e->path = path;
+    } else {
+      s.jobs[n_jobs++] = i;
+    }
+  }
+  ok = ok && pool_run(n_jobs, threads, hash_job, &s);
+
+  // drop what could not be read after all
+  uint32_t kept = 0, job = 0;
+  for (uint32_t i = 0; ok && i < found.n; i++) {
+    const bool failed = job < n_jobs && s.jobs[job] == i && s.failed[job];
+    job += job < n_jobs && s.jobs[job] == i;
+    if (failed)
+      free(found.entries[i].path);
+    else
+      found.entries[kept++] = found.entries[i];
+  }
+  free(s.jobs);
+  free(s.failed);
+  if (!ok) {
+    fprintf(stderr, "Out of memory scanning roms.\n");
+    free_catalog(&found);
+    return false;
+  }
+  found.n = kept;
+  found.hashed = n_jobs;
+  free_catalog(cat);
+  *cat = found;
+  return true;
+}
+
+const catalog_entry_t *catalog_find(const catalog_t *cat,
+                                    const uint64_t hash) {
+  for (uint32_t i = 0; i < cat->n; i++)
+    if (cat->entries[i].hash == hash)
+      return &cat->entries[i];
+  return NULL;
+}
+
+void free_catalog(catalog_t *cat) {
+  for (uint32_t i = 0; i < cat->n; i++)
+    free(cat->entries[i].path);
+  free(cat->entries);
+  *cat = (catalog_t){0};
+}
+
+// the index entry with the image's hash, or a look at the image itself
+// when the index has none. true if it came from the index
+bool lookup_rom(const catalog_t *cat, const uint8_t *rom, const size_t size,
+                catalog_entry_t *e) {
+  const catalog_entry_t *known =
+      catalog_find(cat, fnv1a(FNV_OFFSET, rom, size));
+  if (known)
+    *e = *known;
+  else
+    guess_rom(e, rom, size);
+  return known != NULL;
+}
+
+// the entry's quirks and ips, where the user did not give their own
+void apply_entry(config_t *config, const catalog_entry_t *e) {
+  if (!config->quirks_given)
+    config->quirks = e->quirks;
+  if (!config->ips_given)
+    config->ips = e->ips;
+}
+
+// --quirks and --ips the user left out come from the index entry with the
+// rom's hash, or from a look at the rom itself when the index has none
+void apply_catalog(config_t *config, const char *rom) {
+  if (!config->catalog || (config->quirks_given && config->ips_given))
+    return;
+  size_t size = 0;
+  const uint8_t *image = map_rom(rom, &size);
+  if (!image)
+    return; // init_c8 says what is wrong with it
+  catalog_t cat;
+  load_catalog(&cat, config->catalog); // empty if it fails, then we guess
+  catalog_entry_t e;
+  const bool known = lookup_rom(&cat, image, size, &e);
+  unmap_rom(image, size);
+  free_catalog(&cat);
+
+  apply_entry(config, &e);
+  if (e.platform != PLATFORM_CHIP8)
+    fprintf(stderr, "%s looks like %s (%s): --quirks %s --ips %u\n", rom,
+            platform_name(e.platform), known ? "catalog" : "guessed",
+            quirks_name(config->quirks), config->ips);
+}
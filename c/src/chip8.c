@@ -0,0 +1,132 @@
+#include "../include/chip8.h"
+#include "../include/hash.h"
+#include "../include/ops.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// init chip8 from a rom already in memory, name is only kept for messages
+bool load_c8(chip8_t *c8, char rom_name[], const uint8_t *rom,
+             const size_t rom_s) {
+  // Defaults
+  c8->state = LOADING;          // start emulation and load
+  c8->rom_name = rom_name;      // set c8 rom to the passed rom
+  const uint32_t entry = 0x200; // beginning of c8 memory (can be 0x000)
+  const uint8_t font[] = {
+      0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+      0x20, 0x60, 0x20, 0x20, 0x70, // 1
+      0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+      0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+      0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+      0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+      0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+      0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+      0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+      0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+      0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+      0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+      0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+      0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+      0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+      0xF0, 0x80, 0xF0, 0x80, 0x80, // F
+  };
+  // schip 8x10 digits, A-F as octo draws them
+  const uint8_t big_font[] = {
+      0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, // 0
+      0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, // 1
+      0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, // 2
+      0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, // 3
+      0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, // 4
+      0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, // 5
+      0x3E, 0x7C, 0xE0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, // 6
+      0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, // 7
+      0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, // 8
+      0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C, // 9
+      0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+      0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+      0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+      0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+      0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+      0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0, // F
+  };
+  memcpy(&c8->ram[0], font, sizeof(font)); // copy font to mem
+  memcpy(&c8->ram[BIG_FONT], big_font, sizeof(big_font));
+
+  const size_t max_s = sizeof c8->ram - entry;
+  if (rom_s > max_s) {
+    fprintf(stderr,
+            "Error! ROM is larger than available memory! Max: %zu, ROM: %zu\n",
+            max_s, rom_s);
+    return false;
+  }
+  memcpy(&c8->ram[entry], rom, rom_s);
+
+  c8->rom_hash = fnv1a(FNV_OFFSET, rom, rom_s);
+  c8->state = RUNNING;       // change state and start game
+  c8->fault = FAULT_NONE;    // nothing went wrong yet
+  c8->PC = entry;            // start program counter entry
+  c8->rom_name = rom_name;   // set chip8 rom
+  c8->SP = &c8->stack[0];    // set stack ptr to top of stack
+  c8->dirty_rows = ~0ull;    // first present draws the whole screen
+  c8->wait_key = 0xFF;       // FX0A not waiting
+  c8->planes = 1;            // draw on the first plane, plain chip8
+  c8->pitch = 64;            // xo-chip default rate, 4000Hz
+  seed_c8(c8, DEFAULT_SEED); // same CXNN sequence every run
+  return true;               // successful start-up
+}
+
+// the rom file mapped read only instead of read into a buffer, NULL if it
+// can't be opened. an empty file maps to a zero length image
+const uint8_t *map_rom(const char *path, size_t *size) {
+  static const uint8_t empty[1];
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  struct stat st;
+  const uint8_t *rom = NULL;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    *size = st.st_size;
+    rom = *size ? mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0) : empty;
+    if (rom == MAP_FAILED)
+      rom = NULL;
+  }
+  close(fd); // the mapping stays
+  return rom;
+}
+
+void unmap_rom(const uint8_t *rom, const size_t size) {
+  if (rom && size)
+    munmap((void *)rom, size);
+}
+
+const char *fault_name(const fault_t fault) {
+  static const char *const names[] = {
+      [FAULT_NONE] = "none",
+      [FAULT_STACK_OVERFLOW] = "stack-overflow",
+      [FAULT_STACK_UNDERFLOW] = "stack-underflow",
+  };
+  return names[fault];
+}
+
+// init chip8
+bool init_c8(chip8_t *c8, char rom_name[]) {
+  // load rom
+  size_t rom_s = 0;
+  const uint8_t *rom = map_rom(rom_name, &rom_s);
+  if (!rom) {
+    fprintf(stderr, "Failed to open file %s. Please check the path.\n",
+            rom_name);
+    return false;
+  }
+  const bool ok = load_c8(c8, rom_name, rom, rom_s);
+  unmap_rom(rom, rom_s);
+  return ok;
+}
+
+// CXNN stream, xorshift gets stuck on 0
+void seed_c8(chip8_t *c8, const uint32_t seed) {
+  c8->rng = seed ? seed : DEFAULT_SEED;
+}
@@ -0,0 +1,127 @@
+#include "../include/config.h"
+#include "../include/capture.h"
+#include "../include/catalog.h"
+#include "../include/chip8.h"
+#include "../include/engine.h"
+#include "../include/scheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// get default configs or override with args
+// argv[1] is always the rom, options follow it
+bool set_config_args(config_t *config, const int argc, char **argv) {
+  // defaults
+  *config = (config_t){
+      .window_height = 32,    // chip8 default height
+      .window_width = 64,     // chip8 default width
+      .fcolor = 0xA1A1A1FF,   // dark grey
+      .bcolor = 0xFFFFFFFF,   // white
+      .color2 = 0x5F5F5FFF,   // darker grey
+      .color3 = 0x1F1F1FFF,   // near black
+      .scaler = 15,           // scale window size, ideally get display size
+      .headless = false,      // open a window
+      .cycles = 0,            // run until QUIT
+      .ips = 700,             // roughly what most roms expect
+      .fast_forward = false,  // real time
+      .engine = ENGINE_TABLE, // predecoded dispatch
+      .quirks = QUIRKS_CHIP8, // original cosmac vip behaviour
+      // known roms get their quirks/ips from here
+      .catalog = CATALOG_DEFAULT,
+      .rewind = 30,           // seconds held for rewind
+      .seed = DEFAULT_SEED,   // same CXNN sequence every run
+      .record = NULL,         // no input recording
+      .replay = NULL,         // live input
+      .profile = NULL,        // no profiler
+      .trace = NULL,          // no trace
+      .idle = true,           // skip busy-wait loops
+      .phosphor = 60,         // fades over ~10 frames, flicker dims instead
+      .capture = NULL,        // no frame capture
+  };
+  bool rewind_set = false, format_set = false, backpressure_set = false;
+  // override defaults by arguments
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--headless") == 0) {
+      config->headless = true;
+    } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+      config->cycles = strtoull(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--ips") == 0 && i + 1 < argc) {
+      config->ips = strtoul(argv[++i], NULL, 0);
+      config->ips_given = true;
+    } else if (strcmp(argv[i], "--fast") == 0) {
+      config->fast_forward = true;
+    } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+      if (!parse_engine(argv[++i], &config->engine)) {
+        fprintf(stderr, "Unknown engine: %s\n", argv[i]);
+        return false;
+      }
+    } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      if (!parse_quirks(argv[++i], &config->quirks)) {
+        fprintf(stderr, "Unknown quirks: %s\n", argv[i]);
+        return false;
+      }
+      config->quirks_given = true;
+    } else if (strcmp(argv[i], "--catalog") == 0 && i + 1 < argc) {
+      config->catalog = argv[++i];
+    } else if (strcmp(argv[i], "--no-catalog") == 0) {
+      config->catalog = NULL;
+    } else if (strcmp(argv[i], "--rewind") == 0 && i + 1 < argc) {
+      config->rewind = strtoul(argv[++i], NULL, 0);
+      rewind_set = true;
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      config->seed = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      config->record = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      config->replay = argv[++i];
+    } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+      config->profile = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      config->trace = argv[++i];
+    } else if (strcmp(argv[i], "--no-idle") == 0) {
+      config->idle = false;
+    } else if (strcmp(argv[i], "--phosphor") == 0 && i + 1 < argc) {
+      config->phosphor = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      config->capture = argv[++i];
+    } else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc) {
+      if (!parse_capture_format(argv[++i], &config->capture_format)) {
+        fprintf(stderr, "Unknown capture format: %s\n", argv[i]);
+        return false;
+      }
+      format_set = true;
+    } else if (strcmp(argv[i], "--capture-block") == 0) {
+      config->capture_block = true;
+      backpressure_set = true;
+    } else if (strcmp(argv[i], "--capture-drop") == 0) {
+      config->capture_block = false;
+      backpressure_set = true;
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return false;
+    }
+  }
+  // a frame has to run at least one instruction
+  if (config->ips < TIMER_HZ) {
+    fprintf(stderr, "--ips must be at least %u\n", TIMER_HZ);
+    return false;
+  }
+  if (config->record && config->headless) {
+    fprintf(stderr, "--record needs a window, there is no input headless\n");
+    return false;
+  }
+  if (config->replay && !config->headless) {
+    fprintf(stderr, "--replay runs headless, add --headless\n");
+    return false;
+  }
+  // recording every frame would dominate a flat out run, opt in there
+  if (config->headless && !rewind_set)
+    config->rewind = 0;
+  if (config->capture && !format_set)
+    config->capture_format = capture_format_for(config->capture);
+  // a window must never wait on the disk, a headless run has no clock to
+  // keep up with and wants every frame
+  if (!backpressure_set)
+    config->capture_block = config->headless;
+  return true;
+}
@@ -1,161 +1,223 @@
-#ifdef DEBUG
 #include "../include/debug.h"
-#include <stdio.h>
 
-void print_debug_info(chip8_t *c8) {
-  printf("Current Addr: 0x%04X, OpCode: 0x%04X, Desc: ", c8->PC - 2,
-         c8->instruction.opcode);
-  switch ((c8->instruction.opcode >> 12) & 0x0F) {
+// one line describing the instruction at addr, values read from c8
+void print_op(FILE *out, const chip8_t *c8, const uint16_t addr,
+              const instruction_t ins) {
+  fprintf(out, "Current Addr: 0x%04X, OpCode: 0x%04X, Desc: ", addr,
+           ins.opcode);
+  switch ((ins.opcode >> 12) & 0x0F) {
   case 0x00:
-    if (c8->instruction.NN == 0xE0) {
+    if (ins.NN == 0xE0) {
       // 0x00E0 clear screen
-      printf("Clear Screen!\n");
-    } else if (c8->instruction.NN == 0xEE) {
+      fprintf(out, "Clear Screen!\n");
+    } else if (ins.NN == 0xEE && c8->SP == c8->stack) {
+      fprintf(out, "Return from Subroutine with an empty stack!\n");
+    } else if (ins.NN == 0xEE) {
       // 0x00EE return from subroutine
-      printf("Return from Subroutine to Addr: 0x%04X\n", *(c8->SP - 1));
+      fprintf(out, "Return from Subroutine to Addr: 0x%04X\n", *(c8->SP - 1));
+    } else if ((ins.NN & 0xF0) == 0xC0) {
+      // 00CN scroll down N rows
+      fprintf(out, "Scroll down %X rows!\n", ins.N);
+    } else if ((ins.NN & 0xF0) == 0xD0) {
+      // 00DN scroll up N rows
+      fprintf(out, "Scroll up %X rows!\n", ins.N);
+    } else if (ins.NN == 0xFB || ins.NN == 0xFC) {
+      // 00FB/00FC scroll 4 pixels
+      fprintf(out, "Scroll %s 4 pixels!\n", ins.NN == 0xFB ? "right" : "left");
+    } else if (ins.NN == 0xFD) {
+      // 00FD exit
+      fprintf(out, "Exit!\n");
+    } else if (ins.NN == 0xFE || ins.NN == 0xFF) {
+      // 00FE/00FF lores/hires
+      fprintf(out, "Switch to %s mode!\n", ins.NN == 0xFE ? "lores" : "hires");
     } else {
-      printf("NOOP!\n");
+      fprintf(out, "NOOP!\n");
     } // do nothing, not implemented
     break;
   case 0x01:
     // 1NNN
-    printf("Jump to Addr: NNN (0x%04X)\n", c8->instruction.NNN);
+    fprintf(out, "Jump to Addr: NNN (0x%04X)\n", ins.NNN);
     break;
   case 0x02:
     // 2NNN
-    printf("Call subroutine @ NNN (0x%04X)\n", c8->instruction.NNN);
+    fprintf(out, "Call subroutine @ NNN (0x%04X)\n", ins.NNN);
     break;
   case 0x03:
     // 3XNN Conditional: skip if Vx == NN
-    printf("Jump if equal V%X: 0x%02X , NN: 0x%02X\n", c8->instruction.X,
-           c8->V[c8->instruction.X], c8->instruction.NN);
+    fprintf(out, "Jump if equal V%X: 0x%02X , NN: 0x%02X\n", ins.X,
+            c8->V[ins.X], ins.NN);
     break;
   case 0x04:
     // 4XNN Conditional: skip if VX != NN
-    printf("Jump if not equal V%X: 0x%02X , NN: 0x%02X\n", c8->instruction.X,
-           c8->V[c8->instruction.X], c8->instruction.NN);
+    fprintf(out, "Jump if not equal V%X: 0x%02X , NN: 0x%02X\n", ins.X,
+            c8->V[ins.X], ins.NN);
     break;
   case 0x05:
+    if (ins.N == 2 || ins.N == 3) {
+      // 5XY2/5XY3 save/load VX..VY at I
+      fprintf(out, "%s V%X to V%X %s memory at I (%04X)!\n",
+              ins.N == 2 ? "Store" : "Restore", ins.X, ins.Y,
+              ins.N == 2 ? "in" : "from", c8->I);
+      break;
+    }
     // 5XNN Conditional: skip if VX == VY
-    printf("Jump if not equal V%X: 0x%02X , VY: 0x%02X\n", c8->instruction.X,
-           c8->V[c8->instruction.X], c8->V[c8->instruction.Y]);
+    fprintf(out, "Jump if not equal V%X: 0x%02X , VY: 0x%02X\n", ins.X,
+            c8->V[ins.X], c8->V[ins.Y]);
     break;
   case 0x06:
     // 6XNN set  VX = NN
-    printf(" V%X equals NN: 0x%02X\n", c8->instruction.X, c8->instruction.NN);
+    fprintf(out, " V%X equals NN: 0x%02X\n", ins.X, ins.NN);
     break;
   case 0x07:
     // 7XNN set VX += NN
-    printf("Add V%X: 0x%02X + NN: 0x%02X\n", c8->instruction.X,
-           c8->V[c8->instruction.X], c8->instruction.NN);
+    fprintf(out, "Add V%X: 0x%02X + NN: 0x%02X\n", ins.X,
+            c8->V[ins.X], ins.NN);
     break;
   case 0x08:
-    switch (c8->instruction.N) {
+    switch (ins.N) {
     case 0:
       // set VX = VY
-      printf("V%X = V%X\n", c8->V[c8->instruction.X], c8->V[c8->instruction.Y]);
+      fprintf(out, "V%X (0x%02X) = V%X (0x%02X)\n", ins.X,
+              c8->V[ins.X], ins.Y, c8->V[ins.Y]);
       break;
     case 1:
-      printf("V%X |= V%X\n", c8->V[c8->instruction.X],
-             c8->V[c8->instruction.Y]);
+      fprintf(out, "V%X (0x%02X) |= V%X (0x%02X)\n", ins.X,
+              c8->V[ins.X], ins.Y, c8->V[ins.Y]);
       break;
     case 2:
-      printf("V%X &= V%X\n", c8->V[c8->instruction.X],
-             c8->V[c8->instruction.Y]);
+      fprintf(out, "V%X (0x%02X) &= V%X (0x%02X)\n", ins.X,
+              c8->V[ins.X], ins.Y, c8->V[ins.Y]);
       break;
     case 3:
-      printf("V%X ^= V%X\n", c8->V[c8->instruction.X],
-             c8->V[c8->instruction.Y]);
+      fprintf(out, "V%X (0x%02X) ^= V%X (0x%02X)\n", ins.X,
+              c8->V[ins.X], ins.Y, c8->V[ins.Y]);
       break;
     case 4:
-      printf("V%X += V%X\n", c8->V[c8->instruction.X],
-             c8->V[c8->instruction.Y]);
+      fprintf(out, "V%X (0x%02X) += V%X (0x%02X)\n", ins.X,
+              c8->V[ins.X], ins.Y, c8->V[ins.Y]);
       break;
     case 5:
-      printf("V%X -= V%X\n", c8->V[c8->instruction.X],
-             c8->V[c8->instruction.Y]);
+      fprintf(out, "V%X (0x%02X) -= V%X (0x%02X)\n", ins.X,
+              c8->V[ins.X], ins.Y, c8->V[ins.Y]);
       break;
     case 6:
-      printf("V%X >>= V%X\n", c8->V[c8->instruction.X],
-             c8->V[c8->instruction.Y]);
+      fprintf(out, "V%X (0x%02X) >>= 1\n", ins.X, c8->V[ins.X]);
       break;
     case 7:
-      printf("V%X = V%X - V%X\n", c8->V[c8->instruction.X],
-             c8->V[c8->instruction.Y], c8->V[c8->instruction.X]);
+      fprintf(out, "V%X = V%X (0x%02X) - V%X (0x%02X)\n", ins.X, ins.Y,
+              c8->V[ins.Y], ins.X, c8->V[ins.X]);
       break;
     case 0xE:
-      printf("V%X <<= 1\n", c8->V[c8->instruction.X]);
+      fprintf(out, "V%X (0x%02X) <<= 1\n", ins.X, c8->V[ins.X]);
+      break;
+    default:
+      fprintf(out, "Unimplemented OpCode!\n");
       break;
     }
     break;
   case 0x09:
     // 4XNN Conditional: skip if VX != NN
-    printf("Jump if not equal V%X: 0x%02X , NN: 0x%02X\n", c8->instruction.X,
-           c8->V[c8->instruction.X], c8->instruction.NN);
+    fprintf(out, "Jump if not equal V%X: 0x%02X , NN: 0x%02X\n", ins.X,
+            c8->V[ins.X], ins.NN);
     break;
   case 0x0A:
     // 0xANNN: set I to NNN
-    printf("Set I register to NNN (0x%04X)\n", c8->instruction.NNN);
+    fprintf(out, "Set I register to NNN (0x%04X)\n", ins.NNN);
     break;
   case 0x0B:
     // Jump to V0 + NNN
-    printf("Set PC(0x%04X) equal to V0 (0x%04X) plus NNN (0x%04X)\n", c8->PC,
-           c8->V[c8->instruction.X], c8->instruction.NNN);
+    fprintf(out, "Set PC(0x%04X) equal to V0 (0x%04X) plus NNN (0x%04X)\n",
+            c8->PC, c8->V[0], ins.NNN);
     break;
   case 0x0C:
-    // set VX = rand() % 256 & NN
-    printf("Set VX equal to random number from 0-255 & NN.\n");
+    // set VX = the next xorshift32 byte & NN
+    fprintf(out, "Set VX equal to random number from 0-255 & NN.\n");
     break;
   case 0x0D:
     // DXYN - draw
-    printf("Draw pixel at [V%X, V%X] (0x%02X, 0x%02X) height of %X\n",
-           c8->instruction.X, c8->instruction.Y, c8->V[c8->instruction.X],
-           c8->V[c8->instruction.Y], c8->instruction.N);
+    fprintf(out, "Draw pixel at [V%X, V%X] (0x%02X, 0x%02X) height of %X\n",
+            ins.X, ins.Y, c8->V[ins.X],
+            c8->V[ins.Y], ins.N);
     break;
   case 0x0E:
-    switch (c8->instruction.NN) {
+    switch (ins.NN) {
     case 0x9E:
-      printf("Skip V%X if equal to Get_Key.\n", c8->V[c8->instruction.X]);
+      fprintf(out, "Skip if key V%X (0x%02X) is pressed.\n", ins.X,
+              c8->V[ins.X]);
       break;
     case 0xA1:
+      fprintf(out, "Skip if key V%X (0x%02X) is not pressed.\n", ins.X,
+              c8->V[ins.X]);
+      break;
+    default:
+      fprintf(out, "Unimplemented OpCode!\n");
       break;
     }
     break;
   case 0x0F:
-    switch (c8->instruction.NN) {
+    switch (ins.NN) {
+    case 0x00:
+      fprintf(out, "Set I to the next word (long I)!\n");
+      break;
+    case 0x01:
+      fprintf(out, "Select drawing planes %X!\n", ins.X & 3);
+      break;
+    case 0x02:
+      fprintf(out, "Load audio pattern from I (%04X)!\n", c8->I);
+      break;
+    case 0x30:
+      fprintf(out, "Sets I to the location of the big sprite!\n");
+      break;
+    case 0x3A:
+      fprintf(out, "Set audio pitch to V%X (%02X)!\n", ins.X, c8->V[ins.X]);
+      break;
+    case 0x75:
+      fprintf(out, "Store V0 to VX in flags!\n");
+      break;
+    case 0x85:
+      fprintf(out, "Restore V0 to VX from flags!\n");
+      break;
     case 0x07:
-      printf("Set V%01X to delay_timer (%02X)!\n", c8->instruction.X,
-             c8->delay_timer);
+      fprintf(out, "Set V%01X to delay_timer (%02X)!\n", ins.X,
+              c8->delay_timer);
       break;
     case 0x0A:
-      printf("Awaiting key press!\n");
+      fprintf(out, "Awaiting key press!\n");
       break;
     case 0x15:
-      printf("Set delay timer!\n");
+      fprintf(out, "Set delay timer!\n");
       break;
     case 0x18:
-      printf("Set sound timer!\n");
+      fprintf(out, "Set sound timer!\n");
       break;
     case 0x1E:
-      printf("Add VX to I. Does not change VF!\n");
+      fprintf(out, "Add VX to I. Does not change VF!\n");
       break;
     case 0x29:
-      printf("Sets I to the location of the sprite!\n");
+      fprintf(out, "Sets I to the location of the sprite!\n");
       break;
     case 0x33:
-      printf("Store binary coded decimal. I, I+1, I+2!\n");
+      fprintf(out, "Store binary coded decimal. I, I+1, I+2!\n");
       break;
     case 0x55:
-      printf("Store V0 to VX in memory, starting at I (%04X)!\n", c8->I);
+      fprintf(out, "Store V0 to VX in memory, starting at I (%04X)!\n", c8->I);
       break;
     case 0x65:
-      printf("Restore V0 to VX from memory.\n");
+      fprintf(out, "Restore V0 to VX from memory.\n");
+      break;
+    default:
+      fprintf(out, "Unimplemented OpCode!\n");
       break;
     }
     break;
   default:
-    printf("Unimplemented OpCode!\n");
+    fprintf(out, "Unimplemented OpCode!\n");
     break;
   }
 }
+
+#ifdef DEBUG
+void print_debug_info(chip8_t *c8) {
+  print_op(stdout, c8, c8->PC - 2, c8->instruction);
+}
 #endif
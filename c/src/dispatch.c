@@ -0,0 +1,207 @@
+#include "../include/dispatch.h"
+#include <pthread.h>
+
+op_fn op_table[QUIRK_COUNT][0x10000];
+
+// the handlers a quirk changes, wrapped once per profile with its quirks
+// as constants: op_8xy6_chip8(), op_8xy6_schip(), ...
+#define QUIRK_OPS(H, p)                                                        \
+  H(8xy1, p) H(8xy2, p) H(8xy3, p) H(8xy6, p) H(8xye, p) H(bnnn, p)            \
+  H(dxyn, p) H(fx1e, p) H(fx55, p) H(fx65, p)
+
+#define HANDLER(name, p)                                                       \
+  static void op_##name##_##p(chip8_t *c8, const config_t *config,             \
+                              uint16_t op) {                                   \
+    op_##name(c8, config, op, quirks_##p);                                     \
+  }
+#define X(id, name, ...) QUIRK_OPS(HANDLER, name)
+QUIRK_PROFILES(X)
+#undef X
+#undef HANDLER
+
+typedef struct QuirkOps {
+#define FIELD(name, p) op_fn op_##name;
+  QUIRK_OPS(FIELD, )
+#undef FIELD
+} quirk_ops_t;
+
+static const quirk_ops_t quirk_ops[] = {
+#define ENTRY(name, p) .op_##name = op_##name##_##p,
+#define X(id, name, ...) [QUIRKS_##id] = {QUIRK_OPS(ENTRY, name)},
+    QUIRK_PROFILES(X)
+#undef X
+#undef ENTRY
+};
+
+// same decode as the switch in emulator(), done once per opcode up front
+op_fn decode_op(const uint16_t op, const quirk_profile_t profile) {
+  const quirk_ops_t *q = &quirk_ops[profile];
+  switch (op >> 12) {
+  case 0x0:
+    switch (OP_NN(op)) {
+    case 0xE0:
+      return op_00e0;
+    case 0xEE:
+      return op_00ee;
+    case 0xFB:
+      return op_00fb;
+    case 0xFC:
+      return op_00fc;
+    case 0xFD:
+      return op_00fd;
+    case 0xFE:
+      return op_00fe;
+    case 0xFF:
+      return op_00ff;
+    }
+    if ((OP_NN(op) & 0xF0) == 0xC0)
+      return op_00cn;
+    if ((OP_NN(op) & 0xF0) == 0xD0)
+      return op_00dn;
+    return op_nop;
+  case 0x1:
+    return op_1nnn;
+  case 0x2:
+    return op_2nnn;
+  case 0x3:
+    return op_3xnn;
+  case 0x4:
+    return op_4xnn;
+  case 0x5:
+    if (OP_N(op) == 2)
+      return op_5xy2;
+    if (OP_N(op) == 3)
+      return op_5xy3;
+    return op_5xy0;
+  case 0x6:
+    return op_6xnn;
+  case 0x7:
+    return op_7xnn;
+  case 0x8:
+    switch (OP_N(op)) {
+    case 0x0:
+      return op_8xy0;
+    case 0x1:
+      return q->op_8xy1;
+    case 0x2:
+      return q->op_8xy2;
+    case 0x3:
+      return q->op_8xy3;
+    case 0x4:
+      return op_8xy4;
+    case 0x5:
+      return op_8xy5;
+    case 0x6:
+      return q->op_8xy6;
+    case 0x7:
+      return op_8xy7;
+    case 0xE:
+      return q->op_8xye;
+    }
+    return op_nop;
+  case 0x9:
+    return op_9xy0;
+  case 0xA:
+    return op_annn;
+  case 0xB:
+    return q->op_bnnn;
+  case 0xC:
+    return op_cxnn;
+  case 0xD:
+    return q->op_dxyn;
+  case 0xE:
+    if (OP_NN(op) == 0x9E)
+      return op_ex9e;
+    if (OP_NN(op) == 0xA1)
+      return op_exa1;
+    return op_nop;
+  case 0xF:
+    switch (OP_NN(op)) {
+    case 0x00:
+      return op == 0xF000 ? op_f000 : op_nop;
+    case 0x01:
+      return op_fn01;
+    case 0x02:
+      return op_f002;
+    case 0x07:
+      return op_fx07;
+    case 0x0A:
+      return op_fx0a;
+    case 0x15:
+      return op_fx15;
+    case 0x18:
+      return op_fx18;
+    case 0x1E:
+      return q->op_fx1e;
+    case 0x29:
+      return op_fx29;
+    case 0x30:
+      return op_fx30;
+    case 0x3A:
+      return op_fx3a;
+    case 0x33:
+      return op_fx33;
+    case 0x55:
+      return q->op_fx55;
+    case 0x65:
+      return q->op_fx65;
+    case 0x75:
+      return op_fx75;
+    case 0x85:
+      return op_fx85;
+    }
+    return op_nop;
+  }
+  return op_nop;
+}
+
+// does this op leave PC anywhere but the next instruction, or write ram?
+// either way nothing after it can be decoded ahead of time. the same for
+// every profile
+bool op_ends_block(const uint16_t op) {
+  const quirk_ops_t *q = &quirk_ops[QUIRKS_CHIP8];
+  const op_fn fn = decode_op(op, QUIRKS_CHIP8);
+  return fn == op_00ee || fn == op_1nnn || fn == op_2nnn || fn == op_3xnn ||
+         fn == op_4xnn || fn == op_5xy0 || fn == op_9xy0 ||
+         fn == q->op_bnnn || fn == op_ex9e || fn == op_exa1 ||
+         fn == op_fx0a || fn == op_fx33 || fn == q->op_fx55 ||
+         fn == op_5xy2 || fn == op_f000;
+}
+
+static void build_table(const quirk_profile_t profile) {
+  for (uint32_t op = 0; op < 0x10000; op++)
+    op_table[profile][op] = decode_op(op, profile);
+}
+
+#define X(id, name, ...)                                                       \
+  static void build_##name(void) { build_table(QUIRKS_##id); }
+QUIRK_PROFILES(X)
+#undef X
+
+// safe to call from every instance/thread, each profile's table is only
+// built once and only when something runs with that profile
+void init_dispatch(const quirk_profile_t profile) {
+  static pthread_once_t once[] = {
+#define X(...) PTHREAD_ONCE_INIT,
+      QUIRK_PROFILES(X)
+#undef X
+  };
+  static void (*const build[])(void) = {
+#define X(id, name, ...) [QUIRKS_##id] = build_##name,
+      QUIRK_PROFILES(X)
+#undef X
+  };
+  pthread_once(&once[profile], build[profile]);
+}
+
+// run n instructions: fetch, index, call
+uint32_t dispatch_run(chip8_t *c8, const config_t config, const uint32_t n) {
+  const op_fn *table = op_table[config.quirks];
+  uint32_t i = 0;
+  for (; i < n && c8->state == RUNNING; i++) {
+    const uint16_t op = fetch(c8, c8->PC);
+    c8->PC += 2;
+    table[op](c8, &config, op);
+  }
+  return i;
+}
@@ -1,4 +1,6 @@
 #include "../include/display.h"
+#include "../include/framebuffer.h"
+#include "../include/scheduler.h"
 #include <stdint.h>
 
 void prep_screen(const config_t config, const sdl_t sdl) {
@@ -11,30 +13,35 @@ void prep_screen(const config_t config, const sdl_t sdl) {
   SDL_RenderPresent(sdl.renderer);
 }
 
-void update_screen(const sdl_t sdl, const config_t config, chip8_t *c8) {
-  SDL_FRect rect = {.x = 0, .y = 0, .w = config.scaler, .h = config.scaler};
+// fade and expand the rows DXYN/00E0 touched, and the ones still fading,
+// into the streaming texture and draw it with a single copy. nothing
+// changed = nothing uploaded, nothing presented
+void update_screen(const sdl_t sdl, phosphor_t *ph, chip8_t *c8) {
+  const uint32_t width = screen_width(c8);
+  const uint32_t height = screen_height(c8);
+  const uint64_t dirty = phosphor_advance(ph, c8, now_ns());
+  if (!dirty)
+    return;
 
-  const uint8_t fg_r = (config.fcolor >> 24) & 0xFF;
-  const uint8_t fg_g = (config.fcolor >> 16) & 0xFF;
-  const uint8_t fg_b = (config.fcolor >> 8) & 0xFF;
-  const uint8_t fg_a = (config.fcolor >> 0) & 0xFF;
-
-  const uint8_t bg_r = (config.bcolor >> 24) & 0xFF;
-  const uint8_t bg_g = (config.bcolor >> 16) & 0xFF;
-  const uint8_t bg_b = (config.bcolor >> 8) & 0xFF;
-  const uint8_t bg_a = (config.bcolor >> 0) & 0xFF;
-
-  for (uint32_t i = 0; i < sizeof c8->display; i++) {
-    rect.x = (i % config.window_width) * config.scaler;
-    rect.y = (i / config.window_width) * config.scaler;
-
-    if (c8->display[i]) {
-      SDL_SetRenderDrawColor(sdl.renderer, fg_r, fg_g, fg_b, fg_a);
-      SDL_RenderFillRect(sdl.renderer, &rect);
-    } else {
-      SDL_SetRenderDrawColor(sdl.renderer, bg_r, bg_g, bg_b, bg_a);
-      SDL_RenderFillRect(sdl.renderer, &rect);
-    }
+  // lock the band from the first to the last dirty row
+  const uint32_t first = __builtin_ctzll(dirty);
+  const uint32_t last = 63 - __builtin_clzll(dirty);
+  const SDL_Rect band = {.x = 0, .y = first, .w = width, .h = last - first + 1};
+  void *pixels;
+  int pitch;
+  if (!SDL_LockTexture(sdl.texture, &band, &pixels, &pitch)) {
+    SDL_Log("Failed to lock texture! Error: %s\n", SDL_GetError());
+    return;
   }
+  for (uint32_t y = first; y <= last; y++)
+    phosphor_row(ph, c8, y,
+                 (uint32_t *)((uint8_t *)pixels + (y - first) * pitch));
+  SDL_UnlockTexture(sdl.texture);
+
+  // the part the current mode uses, scaled up to the window by the
+  // renderer, nearest neighbour
+  const SDL_FRect src = {.x = 0, .y = 0, .w = width, .h = height};
+  SDL_RenderTexture(sdl.renderer, sdl.texture, &src, NULL);
   SDL_RenderPresent(sdl.renderer);
+  c8->dirty_rows = 0;
 }
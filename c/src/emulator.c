@@ -1,14 +1,16 @@
 #include "../include/emulator.h"
 #include "../include/debug.h"
+#include "../include/ops.h"
 #include <stdint.h>
 #include <stdio.h>
-#include <stdlib.h>
 
-void emulator(chip8_t *c8, const config_t config) {
-  bool carry;
-  c8->instruction.opcode =
-      (c8->ram[c8->PC] << 8 | c8->ram[c8->PC + 1]); // get opcode
-  c8->PC += 2;                                      // increment PC
+// reference interpreter: full decode into c8->instruction, then a nested
+// switch. the faster engines (dispatch.c) must agree with this one. every
+// copy below gets its profile's quirks as a constant, the tests fold away
+static inline __attribute__((always_inline)) void
+step(chip8_t *c8, const config_t *config, const quirks_t q) {
+  c8->instruction.opcode = fetch(c8, c8->PC); // get opcode
+  c8->PC += 2;                                // increment PC
   // fill chip8 opcode
   c8->instruction.NNN = c8->instruction.opcode & 0x0FFF;
   c8->instruction.NN = c8->instruction.opcode & 0x0FF;
@@ -20,237 +22,170 @@ void emulator(chip8_t *c8, const config_t config) {
   print_debug_info(c8);
 #endif
 
+  const uint16_t op = c8->instruction.opcode;
   switch ((c8->instruction.opcode >> 12) & 0x0F) {
   case 0x00:
-    if (c8->instruction.NN == 0xE0) {
-      // clear screen
-      memset(&c8->display[0], false, sizeof c8->display);
-    } else if (c8->instruction.NN == 0xEE) {
-      // return from subroutine
-      c8->PC = *--c8->SP;
-    } else {
-    } // do nothing, not implemented
+    switch (c8->instruction.NN) {
+    case 0xE0:
+      op_00e0(c8, config, op); // clear screen
+      break;
+    case 0xEE:
+      op_00ee(c8, config, op); // return from subroutine
+      break;
+    case 0xFB:
+      op_00fb(c8, config, op); // scroll right 4
+      break;
+    case 0xFC:
+      op_00fc(c8, config, op); // scroll left 4
+      break;
+    case 0xFD:
+      op_00fd(c8, config, op); // exit
+      break;
+    case 0xFE:
+      op_00fe(c8, config, op); // lores
+      break;
+    case 0xFF:
+      op_00ff(c8, config, op); // hires
+      break;
+    default:
+      if ((c8->instruction.NN & 0xF0) == 0xC0)
+        op_00cn(c8, config, op); // scroll down N
+      else if ((c8->instruction.NN & 0xF0) == 0xD0)
+        op_00dn(c8, config, op); // scroll up N
+      break; // do nothing, not implemented
+    }
     break;
   case 0x01:
-    // goto address
-    c8->PC = c8->instruction.NNN;
+    op_1nnn(c8, config, op); // goto address
     break;
   case 0x02:
-    // call subroutine
-    *c8->SP++ = c8->PC;
-    c8->PC = c8->instruction.NNN;
+    op_2nnn(c8, config, op); // call subroutine
     break;
   case 0x03:
-    // if VX == NN, skip next instruction
-    if (c8->V[c8->instruction.X] == c8->instruction.NN) {
-      c8->PC += 2;
-    }
+    op_3xnn(c8, config, op); // if VX == NN, skip next instruction
     break;
   case 0x04:
-    // if VX != NN, skip next instruction
-    if (c8->V[c8->instruction.X] != c8->instruction.NN) {
-      c8->PC += 2;
-    }
+    op_4xnn(c8, config, op); // if VX != NN, skip next instruction
     break;
   case 0x05:
-    // if VX == VY, skip next instruction
-    if (c8->V[c8->instruction.X] == c8->V[c8->instruction.Y]) {
-      c8->PC += 2;
-    }
+    if (c8->instruction.N == 2)
+      op_5xy2(c8, config, op); // save VX..VY at I
+    else if (c8->instruction.N == 3)
+      op_5xy3(c8, config, op); // load VX..VY from I
+    else
+      op_5xy0(c8, config, op); // if VX == VY, skip next instruction
     break;
   case 0x06:
-    // set VX = NN
-    c8->V[c8->instruction.X] = c8->instruction.NN;
+    op_6xnn(c8, config, op); // set VX = NN
     break;
   case 0x07:
-    // Add NN to VX
-    c8->V[c8->instruction.X] += c8->instruction.NN;
+    op_7xnn(c8, config, op); // Add NN to VX
     break;
   case 0x08: // bit operations
     switch (c8->instruction.N) {
     case 0:
-      // set VX = VY
-      c8->V[c8->instruction.X] = c8->V[c8->instruction.Y];
+      op_8xy0(c8, config, op); // set VX = VY
       break;
     case 1:
-      // VX |= VY
-      c8->V[c8->instruction.X] |= c8->V[c8->instruction.Y];
-      c8->V[0xF] = 0;
+      op_8xy1(c8, config, op, q); // VX |= VY
       break;
     case 2:
-      // VX &= VY
-      c8->V[c8->instruction.X] &= c8->V[c8->instruction.Y];
-      c8->V[0xF] = 0;
+      op_8xy2(c8, config, op, q); // VX &= VY
       break;
     case 3:
-      // VX ^= VY
-      c8->V[c8->instruction.X] ^= c8->V[c8->instruction.Y];
-      c8->V[0xF] = 0;
+      op_8xy3(c8, config, op, q); // VX ^= VY
       break;
     case 4:
-      carry = ((uint16_t)(c8->V[c8->instruction.X] + c8->V[c8->instruction.Y]) >
-               255);
-      // VX += VY
-      c8->V[c8->instruction.X] += c8->V[c8->instruction.Y];
-      c8->V[0xF] = carry;
+      op_8xy4(c8, config, op); // VX += VY
       break;
     case 5:
-      carry = (c8->V[c8->instruction.Y] <= c8->V[c8->instruction.X]);
-      // VX -= VY
-      c8->V[c8->instruction.X] -= c8->V[c8->instruction.Y];
-      c8->V[0xF] = carry;
+      op_8xy5(c8, config, op); // VX -= VY
       break;
     case 6:
-      carry = c8->V[c8->instruction.Y] & 1;
-      // VX >>= VY
-      c8->V[c8->instruction.X] = c8->V[c8->instruction.Y] >> 1;
-      c8->V[0xF] = carry;
+      op_8xy6(c8, config, op, q); // VX >>= 1
       break;
     case 7:
-      carry = (c8->V[c8->instruction.X] <= c8->V[c8->instruction.Y]);
-      // VX = VY - VX
-      c8->V[c8->instruction.X] =
-          c8->V[c8->instruction.Y] - c8->V[c8->instruction.X];
-      c8->V[0xF] = carry;
+      op_8xy7(c8, config, op); // VX = VY - VX
       break;
     case 0xE:
-      carry = (c8->V[c8->instruction.Y] & 0x80) >> 7;
-      // VX <<= 1
-      c8->V[c8->instruction.X] = c8->V[c8->instruction.Y] <<= 1;
-      c8->V[0xF] = carry;
+      op_8xye(c8, config, op, q); // VX <<= 1
       break;
     }
     break;
   case 0x09:
-    // if VX != VY, skip next instruction
-    if (c8->V[c8->instruction.X] != c8->V[c8->instruction.Y]) {
-      c8->PC += 2;
-    }
+    op_9xy0(c8, config, op); // if VX != VY, skip next instruction
     break;
   case 0x0A:
-    // set I to NNN
-    c8->I = c8->instruction.NNN;
+    op_annn(c8, config, op); // set I to NNN
     break;
   case 0x0B:
-    // set PC = VX + NNN
-    c8->PC = (c8->V[c8->instruction.X] + c8->instruction.NNN);
+    op_bnnn(c8, config, op, q); // set PC = VX + NNN
     break;
   case 0x0C:
-    // set VX = rand() & NN
-    c8->V[c8->instruction.X] = (rand() % 256) & c8->instruction.NN;
+    op_cxnn(c8, config, op); // set VX = xorshift32 & NN
     break;
   case 0x0D:
-    // draw at [VX,VY] with a height of N
-    // original location
-    const uint8_t oX_coord = c8->V[c8->instruction.X] % config.window_width;
-    // mutable locations
-    uint8_t X_coord = c8->V[c8->instruction.X] % config.window_width;
-    uint8_t Y_coord = c8->V[c8->instruction.Y] % config.window_height;
-
-    c8->V[0xF] = 0; // init carry flag to 0
-    // loop N rows (X) of sprite
-    for (uint8_t i = 0; i < c8->instruction.N; i++) {
-      // sprite data = I + loop [i]
-      uint8_t sprite_d = c8->ram[c8->I + i];
-      // return to og X position
-      X_coord = oX_coord;
-      // loop N columns (Y) of sprite
-      for (int j = 7; j >= 0; j--) {
-        // left shit 1 by loop and make sure it is still in the window
-        if ((sprite_d & (1 << j)) &&
-            c8->display[Y_coord * config.window_width + X_coord]) {
-          // set carry flag
-          c8->V[0x0F] = 1;
-        }
-        c8->display[Y_coord * config.window_width + X_coord] ^=
-            (sprite_d & (1 << j));
-        // stop if past right of screen
-        if (++X_coord >= config.window_width)
-          break;
-      }
-      // stop if bottom of screen
-      if (++Y_coord >= config.window_height)
-        break;
-    }
+    op_dxyn(c8, config, op, q); // draw at [VX,VY] with a height of N
     break;
   case 0x0E:
     // if VX = Key, skip next instruction
     // else VX != Key, skip this instruction
     if (c8->instruction.NN == 0x9E) {
-      if (c8->keys[c8->V[c8->instruction.X]])
-        c8->PC += 2;
+      op_ex9e(c8, config, op);
     } else if (c8->instruction.NN == 0xA1) {
-      if (!c8->keys[c8->V[c8->instruction.X]])
-        c8->PC += 2;
+      op_exa1(c8, config, op);
     }
     break;
   case 0x0F:
     switch (c8->instruction.NN) {
+    case 0x00:
+      if (op == 0xF000)
+        op_f000(c8, config, op); // set I to the next 16 bits
+      break;
+    case 0x01:
+      op_fn01(c8, config, op); // select planes
+      break;
+    case 0x02:
+      op_f002(c8, config, op); // load audio pattern
+      break;
     case 0x07:
-      // set VX to  delay_timer value
-      c8->V[c8->instruction.X] = c8->delay_timer;
+      op_fx07(c8, config, op); // set VX to  delay_timer value
       break;
     case 0x0A:
-      // set VX = key pressed
-      static bool key_pressed = false;
-      static uint8_t key = 0xFF;
-
-      for (uint8_t i = 0; key == 0xFF && i < sizeof c8->keys; i++) {
-        if (c8->keys[i]) {
-          key = i;
-          key_pressed = true;
-          break;
-        }
-        if (!key_pressed)
-          c8->PC -= 2;
-        else {
-          if (c8->keys[key])
-            // busy loop, wait for key up
-            c8->PC -= 2;
-          else {
-            c8->V[c8->instruction.X] = key;
-            key = 0xFF;
-            key_pressed = false;
-          }
-        }
-      }
+      op_fx0a(c8, config, op); // set VX = key pressed
       break;
     case 0x15:
-      // set delay timer
-      c8->delay_timer = c8->V[c8->instruction.X];
+      op_fx15(c8, config, op); // set delay timer
       break;
     case 0x18:
-      // set sound timer
-      c8->sound_timer = c8->V[c8->instruction.X];
+      op_fx18(c8, config, op); // set sound timer
       break;
     case 0x1E:
-      // set I to VX
-      c8->I = c8->V[c8->instruction.X];
-      // amiga sets carry flag, 1 known game relies on it so...
-      if (c8->I > 0x0FFF)
-        c8->V[0x0F] = 1;
+      op_fx1e(c8, config, op, q); // add VX to I
       break;
     case 0x29:
-      // set I to location of sprite
-      c8->I = c8->V[c8->instruction.X] * 5;
+      op_fx29(c8, config, op); // set I to location of sprite
+      break;
+    case 0x30:
+      op_fx30(c8, config, op); // set I to location of big sprite
       break;
     case 0x33:
-      // Binary Coded Decimal of VX:
-      uint8_t bcd = c8->V[c8->instruction.X];
-      // 1's in I+2
-      c8->ram[c8->I + 2] = bcd % 10;
-      bcd /= 10;
-      // 10's in I+1
-      c8->ram[c8->I + 1] = bcd % 10;
-      bcd /= 10;
-      // 100's in I
-      c8->ram[c8->I] = bcd;
+      op_fx33(c8, config, op); // Binary Coded Decimal of VX
       break;
     case 0x55:
-      // dump register values into memory
+      op_fx55(c8, config, op, q); // dump register values into memory
+      break;
+    case 0x3A:
+      op_fx3a(c8, config, op); // set audio pitch
       break;
     case 0x65:
-      // restore registers from memory
+      op_fx65(c8, config, op, q); // restore registers from memory
+      break;
+    case 0x75:
+      op_fx75(c8, config, op); // save registers to flags
+      break;
+    case 0x85:
+      op_fx85(c8, config, op); // restore registers from flags
       break;
     }
     break;
@@ -258,16 +193,51 @@ void emulator(chip8_t *c8, const config_t config) {
     printf("Error! OpCode not implemented! 0x%04X\n", c8->instruction.opcode);
     break;
   }
+}
+
+// step_chip8() and run_chip8() etc, one of each per quirk profile
+#define X(id, name, ...)                                                       \
+  static void step_##name(chip8_t *c8, const config_t *config) {               \
+    step(c8, config, quirks_##name);                                           \
+  }                                                                            \
+  static uint32_t run_##name(chip8_t *c8, const config_t *config,              \
+                             const uint32_t n) {                               \
+    uint32_t i = 0;                                                            \
+    for (; i < n && c8->state == RUNNING; i++)                                 \
+      step(c8, config, quirks_##name);                                         \
+    return i;                                                                  \
+  }
+QUIRK_PROFILES(X)
+#undef X
+
+static void (*const steps[])(chip8_t *, const config_t *) = {
+#define X(id, name, ...) [QUIRKS_##id] = step_##name,
+    QUIRK_PROFILES(X)
+#undef X
+};
+
+static uint32_t (*const runs[])(chip8_t *, const config_t *, uint32_t) = {
+#define X(id, name, ...) [QUIRKS_##id] = run_##name,
+    QUIRK_PROFILES(X)
+#undef X
+};
+
+// one instruction through the reference interpreter for config.quirks
+void emulator(chip8_t *c8, const config_t config) {
+  steps[config.quirks](c8, &config);
+}
+
+// up to n instructions, the profile is looked up once, not per instruction
+uint32_t emulator_run(chip8_t *c8, const config_t config, const uint32_t n) {
+  return runs[config.quirks](c8, &config, n);
+}
 
-  // handle timers
+// 60Hz, called by the scheduler once per frame, not per instruction
+void update_timers(chip8_t *c8) {
   if (c8->delay_timer != 0) {
     c8->delay_timer--;
-  } else {
-    c8->delay_timer = 0;
   }
   if (c8->sound_timer != 0) {
     c8->sound_timer--;
-  } else {
-    c8->sound_timer = 0;
   }
 }
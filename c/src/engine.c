@@ -0,0 +1,86 @@
+#include "../include/engine.h"
+#include "../include/dispatch.h"
+#include "../include/emulator.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *const names[] = {
+    [ENGINE_SWITCH] = "switch",
+    [ENGINE_TABLE] = "table",
+    [ENGINE_BLOCK] = "block",
+    [ENGINE_JIT] = "jit",
+};
+
+const char *engine_name(const engine_kind_t kind) { return names[kind]; }
+
+bool parse_engine(const char *name, engine_kind_t *kind) {
+  for (uint32_t i = 0; i < sizeof names / sizeof names[0]; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      *kind = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// quirks picks the handler table the table, block and jit engines use
+bool init_engine(engine_t *e, const engine_kind_t kind,
+                 const quirk_profile_t quirks) {
+  *e = (engine_t){.kind = kind};
+  if (kind != ENGINE_SWITCH)
+    init_dispatch(quirks);
+  if (kind == ENGINE_BLOCK && !(e->blocks = new_block_cache())) {
+    fprintf(stderr, "Failed to allocate block cache!\n");
+    return false;
+  }
+  if (kind == ENGINE_JIT && !(e->jit = new_jit())) {
+    // no x86-64 or no executable memory, the block cache is next best
+    fprintf(stderr, "JIT unavailable, using the block engine.\n");
+    return init_engine(e, ENGINE_BLOCK, quirks);
+  }
+  return true;
+}
+
+void free_engine(engine_t *e) {
+  free_block_cache(e->blocks);
+  free_jit(e->jit);
+  e->blocks = NULL;
+  e->jit = NULL;
+}
+
+void print_engine_stats(const engine_t *e) {
+  if (e->kind == ENGINE_JIT) {
+    const uint64_t total = e->jit->native + e->jit->interpreted;
+    printf("jit: %llu blocks compiled, %.2f%% native, %llu invalidated, "
+           "%llu flushes\n",
+           (unsigned long long)e->jit->compiled,
+           total ? 100.0 * e->jit->native / total : 0.0,
+           (unsigned long long)e->jit->invalidations,
+           (unsigned long long)e->jit->flushes);
+  }
+  if (e->kind != ENGINE_BLOCK)
+    return;
+  const uint64_t lookups = e->blocks->hits + e->blocks->misses;
+  printf("blocks: %llu hits, %llu misses (%.2f%% hit rate), %llu "
+         "invalidated\n",
+         (unsigned long long)e->blocks->hits,
+         (unsigned long long)e->blocks->misses,
+         lookups ? 100.0 * e->blocks->hits / lookups : 0.0,
+         (unsigned long long)e->blocks->invalidations);
+}
+
+// run up to n instructions, returns how many actually ran
+uint32_t engine_run(engine_t *e, chip8_t *c8, const config_t config,
+                    const uint32_t n) {
+  switch (e->kind) {
+  case ENGINE_TABLE:
+    return dispatch_run(c8, config, n);
+  case ENGINE_BLOCK:
+    return block_run(e->blocks, c8, config, n);
+  case ENGINE_JIT:
+    return jit_run(e->jit, c8, config, n);
+  case ENGINE_SWITCH:
+  default:
+    return emulator_run(c8, config, n);
+  }
+}
@@ -0,0 +1,129 @@
+#include "../include/headless.h"
+#include "../include/chip8.h"
+#include "../include/profile.h"
+#include "../include/replay.h"
+#include "../include/savestate.h"
+#include "../include/scheduler.h"
+#include "../include/trace.h"
+#include <stdio.h>
+
+// run flat out until cycles have run (0 = forever) or the rom quits. the
+// timers still tick once per ips / 60 instructions, just never sleep.
+// every finished frame goes into rw and cap when there are ones
+uint64_t run_for(scheduler_t *s, chip8_t *c8, const config_t config,
+                 const uint64_t cycles, rewind_t *rw, capture_t *cap) {
+  const uint64_t start = s->cycles;
+  while (c8->state == RUNNING &&
+         (cycles == 0 || s->cycles - start < cycles)) {
+    const uint64_t left = cycles - (s->cycles - start);
+    run_frame(s, c8, config,
+              cycles == 0 || left > UINT32_MAX ? UINT32_MAX : left);
+    if (rw && !s->in_frame)
+      rewind_record(rw, c8, s);
+    if (cap && !s->in_frame)
+      capture_frame(cap, c8);
+  }
+  return s->cycles - start;
+}
+
+bool run_headless(chip8_t *c8, config_t config) {
+  scheduler_t sched;
+  rewind_t rw = {0};
+  replay_t rp = {0};
+  if (config.replay) {
+    if (!load_replay(&rp, c8, config.replay))
+      return false;
+    // the recording's workload, not --seed/--ips/--quirks or the catalog
+    seed_c8(c8, rp.seed);
+    config.ips = rp.ips;
+    config.quirks = rp.quirks;
+  }
+  if (!init_scheduler(&sched, config)) {
+    free_replay(&rp);
+    return false;
+  }
+  if (config.rewind && !init_rewind(&rw, config.rewind)) {
+    free_scheduler(&sched);
+    free_replay(&rp);
+    return false;
+  }
+
+  if (config.profile && !(c8->prof = new_profile())) {
+    free_rewind(&rw);
+    free_scheduler(&sched);
+    free_replay(&rp);
+    return false;
+  }
+  trace_t tr = {0};
+  if (config.trace && !init_trace(&tr, c8, config.trace)) {
+    free_profile(c8->prof);
+    c8->prof = NULL;
+    free_rewind(&rw);
+    free_scheduler(&sched);
+    free_replay(&rp);
+    return false;
+  }
+  if (config.trace)
+    c8->trace = &tr; // the engine is bypassed while tracing
+  capture_t cap;
+  if (config.capture && !start_capture(&cap, config.capture, config)) {
+    free_trace(&tr);
+    c8->trace = NULL;
+    free_profile(c8->prof);
+    c8->prof = NULL;
+    free_rewind(&rw);
+    free_scheduler(&sched);
+    free_replay(&rp);
+    return false;
+  }
+
+  uint64_t start = now_ns();
+  const uint64_t cycles =
+      config.replay
+          ? run_replay(&rp, &sched, c8, config,
+                       config.capture ? &cap : NULL)
+          : run_for(&sched, c8, config, config.cycles,
+                    config.rewind ? &rw : NULL, config.capture ? &cap : NULL);
+  const double secs = (now_ns() - start) / 1e9;
+  // the rest of the capture queue, not part of the timing
+  const bool captured = !config.capture || stop_capture(&cap);
+  profile_time(c8->prof, PROF_EMULATION, &start); // all of it, no host side
+  // MIPS of what actually ran, idle laps skipped are counted below
+  const uint64_t executed = cycles - sched.idled;
+  printf("%s: %llu cycles in %.6fs (%.2f MIPS, %s)\n", c8->rom_name,
+         (unsigned long long)cycles, secs,
+         secs > 0 ? executed / secs / 1e6 : 0.0, engine_name(config.engine));
+  if (config.replay)
+    printf("replayed %u of %u frames from %s\n", rp.pos, rp.frames,
+           config.replay);
+  printf("state %016llx\n", (unsigned long long)state_hash(c8));
+  if (c8->fault)
+    printf("stopped by %s at 0x%03X\n", fault_name(c8->fault), c8->PC - 2);
+  print_engine_stats(&sched.engine);
+  if (sched.idled)
+    printf("idle: %llu instructions skipped (%.2f%%), not in the MIPS\n",
+           (unsigned long long)sched.idled,
+           cycles ? 100.0 * sched.idled / cycles : 0.0);
+  print_rewind_stats(&rw);
+  if (config.capture)
+    print_capture_stats(&cap);
+  const bool profiled =
+      !c8->prof || write_profile(c8->prof, c8, config.profile);
+  if (c8->prof && profiled)
+    printf("profile written to %s.txt and %s.folded\n", config.profile,
+           config.profile);
+  const bool traced = !c8->trace || flush_trace(c8->trace);
+  if (c8->trace && traced)
+    printf("trace of the last %llu records written to %s\n",
+           (unsigned long long)(tr.records < TRACE_RECORDS ? tr.records
+                                                           : TRACE_RECORDS),
+           config.trace);
+  free_profile(c8->prof);
+  c8->prof = NULL;
+  free_trace(&tr);
+  c8->trace = NULL;
+  free_rewind(&rw);
+  free_replay(&rp);
+  free_scheduler(&sched);
+  return captured && profiled && traced;
+}
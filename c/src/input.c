@@ -1,134 +1,72 @@
 #include "../include/input.h"
+#include "../include/framebuffer.h"
 
-// all input
-void input_handler(chip8_t *c8) {
+// host key to chip8 key, MAPPED tells key 0 from no key
+#define MAPPED 0x10
+static const uint8_t keymap[128] = {
+    [SDLK_1] = MAPPED | 0x1, [SDLK_2] = MAPPED | 0x2, [SDLK_3] = MAPPED | 0x3,
+    [SDLK_4] = MAPPED | 0xC, [SDLK_Q] = MAPPED | 0x4, [SDLK_W] = MAPPED | 0x5,
+    [SDLK_E] = MAPPED | 0x6, [SDLK_R] = MAPPED | 0xD, [SDLK_A] = MAPPED | 0x7,
+    [SDLK_S] = MAPPED | 0x8, [SDLK_D] = MAPPED | 0x9, [SDLK_F] = MAPPED | 0xE,
+    [SDLK_Z] = MAPPED | 0xA, [SDLK_X] = MAPPED | 0x0, [SDLK_C] = MAPPED | 0xB,
+    [SDLK_V] = MAPPED | 0xF,
+};
+
+// all input. nothing here touches the machine, chip8 keys (with the time
+// SDL saw them) and hotkeys go to the emulation thread as commands. shown is
+// the frontend's copy of the display
+void input_handler(chip8_t *shown, runner_t *r) {
+  const uint64_t clock = now_ns() - SDL_GetTicksNS(); // SDL ticks to now_ns
   SDL_Event event;
   while (SDL_PollEvent(&event)) {
+    if ((event.type == SDL_EVENT_KEY_DOWN || event.type == SDL_EVENT_KEY_UP) &&
+        event.key.key < sizeof keymap && keymap[event.key.key]) {
+      if (!event.key.repeat)
+        runner_command(r, (command_t){
+                              .kind = CMD_KEY,
+                              .key.ns = event.key.timestamp + clock,
+                              .key.key = keymap[event.key.key] & 0xF,
+                              .key.down = event.type == SDL_EVENT_KEY_DOWN,
+                          });
+      continue;
+    }
     switch (event.type) {
     case SDL_EVENT_QUIT:
-      c8->state = QUIT;
+      runner_command(r, (command_t){.kind = CMD_QUIT});
       return;
+    case SDL_EVENT_WINDOW_EXPOSED:
+      shown->dirty_rows = ALL_ROWS; // window contents lost, redraw everything
+      break;
     case SDL_EVENT_KEY_DOWN:
       switch (event.key.key) {
       case SDLK_ESCAPE:
-        c8->state = QUIT;
+        runner_command(r, (command_t){.kind = CMD_QUIT});
         return;
       case SDLK_SEMICOLON:
-        if (c8->state == RUNNING) {
-          c8->state = PAUSED;
-          SDL_Log("===PAUSED===");
-        } else {
-          SDL_Log("===RESUME===");
-          c8->state = RUNNING;
-        }
-        break;
-      // Map chip8 keys
-      case SDLK_1:
-        c8->keys[0x1] = true;
-        break;
-      case SDLK_2:
-        c8->keys[0x2] = true;
-        break;
-      case SDLK_3:
-        c8->keys[0x3] = true;
-        break;
-      case SDLK_4:
-        c8->keys[0xC] = true;
-        break;
-      case SDLK_Q:
-        c8->keys[0x4] = true;
-        break;
-      case SDLK_W:
-        c8->keys[0x5] = true;
+        SDL_Log("%s",
+                runner_state(r) == PAUSED ? "===RESUME===" : "===PAUSED===");
+        runner_command(r, (command_t){.kind = CMD_PAUSE});
         break;
-      case SDLK_E:
-        c8->keys[0x6] = true;
+      case SDLK_BACKSPACE:
+        if (!event.key.repeat)
+          runner_command(r, (command_t){.kind = CMD_REWIND, .on = true});
         break;
-      case SDLK_R:
-        c8->keys[0xD] = true;
+      case SDLK_F5:
+        runner_command(r, (command_t){.kind = CMD_SAVE});
         break;
-      case SDLK_A:
-        c8->keys[0x7] = true;
+      case SDLK_F8:
+        runner_command(r, (command_t){.kind = CMD_TRACE});
         break;
-      case SDLK_S:
-        c8->keys[0x8] = true;
-        break;
-      case SDLK_D:
-        c8->keys[0x9] = true;
-        break;
-      case SDLK_F:
-        c8->keys[0xE] = true;
-        break;
-      case SDLK_Z:
-        c8->keys[0xA] = true;
-        break;
-      case SDLK_X:
-        c8->keys[0x0] = true;
-        break;
-      case SDLK_C:
-        c8->keys[0xB] = true;
-        break;
-      case SDLK_V:
-        c8->keys[0xF] = true;
+      case SDLK_F9:
+        runner_command(r, (command_t){.kind = CMD_LOAD});
         break;
       default:
         break;
       }
       break;
     case SDL_EVENT_KEY_UP:
-      switch (event.key.key) {
-      // Map chip8 keys
-      case SDLK_1:
-        c8->keys[0x1] = false;
-        break;
-      case SDLK_2:
-        c8->keys[0x2] = false;
-        break;
-      case SDLK_3:
-        c8->keys[0x3] = false;
-        break;
-      case SDLK_4:
-        c8->keys[0xC] = false;
-        break;
-      case SDLK_Q:
-        c8->keys[0x4] = false;
-        break;
-      case SDLK_W:
-        c8->keys[0x5] = false;
-        break;
-      case SDLK_E:
-        c8->keys[0x6] = false;
-        break;
-      case SDLK_R:
-        c8->keys[0xD] = false;
-        break;
-      case SDLK_A:
-        c8->keys[0x7] = false;
-        break;
-      case SDLK_S:
-        c8->keys[0x8] = false;
-        break;
-      case SDLK_D:
-        c8->keys[0x9] = false;
-        break;
-      case SDLK_F:
-        c8->keys[0xE] = false;
-        break;
-      case SDLK_Z:
-        c8->keys[0xA] = false;
-        break;
-      case SDLK_X:
-        c8->keys[0x0] = false;
-        break;
-      case SDLK_C:
-        c8->keys[0xB] = false;
-        break;
-      case SDLK_V:
-        c8->keys[0xF] = false;
-        break;
-      default:
-        break;
-      }
+      if (event.key.key == SDLK_BACKSPACE)
+        runner_command(r, (command_t){.kind = CMD_REWIND, .on = false});
       break;
     default:
       break;
@@ -0,0 +1,631 @@
+#include "../include/jit.h"
+#include "../include/dispatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__)
+#include <stddef.h>
+#include <sys/mman.h>
+
+#define ARENA_SIZE (4u << 20) // flushed and reused when full
+#define JIT_MAX 64            // instructions per block
+#define JIT_WORST 4096        // more than one block can ever emit
+#define JIT_STRIKES 4         // invalidations before a pc stays interpreted
+
+// host registers
+enum {
+  RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+  R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+// c8 is kept in rbx, I in r15, rax/rdx are scratch. the V registers a block
+// touches are loaded into these at entry and stored back at every exit
+static const uint8_t pool[] = {RSI, RDI, RBP, R8, R9, R10, R11, R12, R13, R14};
+#define REG_I R15
+
+#define OFF_V ((int32_t)offsetof(chip8_t, V))
+#define OFF_I ((int32_t)offsetof(chip8_t, I))
+#define OFF_PC ((int32_t)offsetof(chip8_t, PC))
+#define OFF_DT ((int32_t)offsetof(chip8_t, delay_timer))
+#define OFF_ST ((int32_t)offsetof(chip8_t, sound_timer))
+
+typedef struct Emitter {
+  uint8_t *p;
+  int8_t host[16];  // V -> host register, -1 when the block doesn't use it
+  uint16_t written; // V registers stored back on exit
+  bool uses_i;
+  bool writes_i;
+} emit_t;
+
+// can op be translated? fills the V registers it touches and whether it
+// ends the block (branches). anything that draws, waits, calls, writes ram
+// or needs the rng stays in the interpreter
+static bool translatable(const uint16_t op, const quirks_t q, uint16_t *regs,
+                         bool *uses_i, bool *ends) {
+  const uint16_t x = 1u << OP_X(op), y = 1u << OP_Y(op), f = 1u << 0xF;
+  *regs = 0;
+  *uses_i = false;
+  *ends = false;
+  switch (op >> 12) {
+  case 0x0:
+    return decode_op(op, QUIRKS_CHIP8) == op_nop; // 0NNN, schip ops draw
+  case 0x1:
+    *ends = true;
+    return true;
+  case 0x3:
+  case 0x4:
+    *regs = x;
+    *ends = true;
+    return true;
+  case 0x5:
+    if (OP_N(op) == 2 || OP_N(op) == 3)
+      return false; // xo-chip register save/load
+    *regs = x | y;
+    *ends = true;
+    return true;
+  case 0x9:
+    *regs = x | y;
+    *ends = true;
+    return true;
+  case 0x6:
+  case 0x7:
+    *regs = x;
+    return true;
+  case 0x8:
+    switch (OP_N(op)) {
+    case 0x0:
+      *regs = x | y;
+      return true;
+    case 0x1:
+    case 0x2:
+    case 0x3:
+      *regs = x | y | (q.vf_reset ? f : 0);
+      return true;
+    case 0x4:
+    case 0x5:
+    case 0x7:
+      *regs = x | y | f;
+      return true;
+    case 0x6:
+    case 0xE:
+      *regs = x | (q.shift_vx ? 0 : y) | f;
+      return true;
+    }
+    return true; // no-op
+  case 0xA:
+    *uses_i = true;
+    return true;
+  case 0xF:
+    switch (OP_NN(op)) {
+    case 0x07:
+    case 0x15:
+    case 0x18:
+      *regs = x;
+      return true;
+    case 0x1E:
+      *regs = x | (q.i_overflow ? f : 0);
+      *uses_i = true;
+      return true;
+    case 0x29:
+      *regs = x;
+      *uses_i = true;
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+
+// x86-64 encoding
+static void emit8(emit_t *e, const uint8_t b) { *e->p++ = b; }
+
+static void emit32(emit_t *e, const uint32_t v) {
+  for (int i = 0; i < 4; i++)
+    emit8(e, v >> (i * 8));
+}
+
+// always emit a REX so 4-7 mean sil/dil/bpl/spl and never ah/ch/dh/bh
+static void rex(emit_t *e, const bool w, const uint8_t reg, const uint8_t rm) {
+  emit8(e, 0x40 | w << 3 | (reg >> 3) << 2 | (rm >> 3));
+}
+
+static void modrm_reg(emit_t *e, const uint8_t reg, const uint8_t rm) {
+  emit8(e, 0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+// [rbx + disp32]
+static void modrm_c8(emit_t *e, const uint8_t reg, const int32_t disp) {
+  emit8(e, 0x80 | (reg & 7) << 3 | RBX);
+  emit32(e, disp);
+}
+
+// op r/m8, r8 (mov 88, or 08, and 20, xor 30, add 00, sub 28, cmp 38)
+static void alu8(emit_t *e, const uint8_t opc, const uint8_t dst,
+                 const uint8_t src) {
+  rex(e, false, src, dst);
+  emit8(e, opc);
+  modrm_reg(e, src, dst);
+}
+
+// group 1 r/m8, imm8 (/0 add, /7 cmp)
+static void alu8_imm(emit_t *e, const uint8_t ext, const uint8_t dst,
+                     const uint8_t imm) {
+  rex(e, false, 0, dst);
+  emit8(e, 0x80);
+  modrm_reg(e, ext, dst);
+  emit8(e, imm);
+}
+
+// shift r/m8 by 1 (/4 shl, /5 shr)
+static void shift1(emit_t *e, const uint8_t ext, const uint8_t dst) {
+  rex(e, false, 0, dst);
+  emit8(e, 0xD0);
+  modrm_reg(e, ext, dst);
+}
+
+// setc (0x92) / setnc (0x93) / seta (0x97) r/m8
+static void setcc(emit_t *e, const uint8_t cc, const uint8_t dst) {
+  rex(e, false, 0, dst);
+  emit8(e, 0x0F);
+  emit8(e, cc);
+  modrm_reg(e, 0, dst);
+}
+
+static void mov_imm32(emit_t *e, const uint8_t dst, const uint32_t imm) {
+  if (dst >= 8)
+    emit8(e, 0x41);
+  emit8(e, 0xB8 + (dst & 7));
+  emit32(e, imm);
+}
+
+// movzx r32, r/m8
+static void movzx8(emit_t *e, const uint8_t dst, const uint8_t src) {
+  rex(e, false, dst, src);
+  emit8(e, 0x0F);
+  emit8(e, 0xB6);
+  modrm_reg(e, dst, src);
+}
+
+static void push(emit_t *e, const uint8_t r) {
+  if (r >= 8)
+    emit8(e, 0x41);
+  emit8(e, 0x50 + (r & 7));
+}
+
+static void pop(emit_t *e, const uint8_t r) {
+  if (r >= 8)
+    emit8(e, 0x41);
+  emit8(e, 0x58 + (r & 7));
+}
+
+// jcc rel32 (0x84 je, 0x85 jne), returns where to patch the target
+static uint8_t *jcc(emit_t *e, const uint8_t cc) {
+  emit8(e, 0x0F);
+  emit8(e, cc);
+  uint8_t *patch = e->p;
+  emit32(e, 0);
+  return patch;
+}
+
+static void patch_here(emit_t *e, uint8_t *patch) {
+  const int32_t rel = e->p - (patch + 4);
+  for (int i = 0; i < 4; i++)
+    patch[i] = (uint32_t)rel >> (i * 8);
+}
+
+static void prologue(emit_t *e) {
+  push(e, RBX);
+  push(e, RBP);
+  push(e, R12);
+  push(e, R13);
+  push(e, R14);
+  push(e, R15);
+  // mov rbx, rdi
+  emit8(e, 0x48);
+  emit8(e, 0x89);
+  modrm_reg(e, RDI, RBX);
+  for (uint8_t v = 0; v < 16; v++) {
+    if (e->host[v] < 0)
+      continue;
+    // movzx host, byte [rbx + V + v]
+    rex(e, false, e->host[v], RBX);
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    modrm_c8(e, e->host[v], OFF_V + v);
+  }
+  if (e->uses_i) {
+    // movzx r15d, word [rbx + I]
+    rex(e, false, REG_I, RBX);
+    emit8(e, 0x0F);
+    emit8(e, 0xB7);
+    modrm_c8(e, REG_I, OFF_I);
+  }
+}
+
+// write back what the block changed, set PC and return to the dispatcher
+static void exit_to(emit_t *e, const uint16_t pc) {
+  for (uint8_t v = 0; v < 16; v++) {
+    if (!(e->written & (1u << v)))
+      continue;
+    // mov byte [rbx + V + v], host8
+    rex(e, false, e->host[v], RBX);
+    emit8(e, 0x88);
+    modrm_c8(e, e->host[v], OFF_V + v);
+  }
+  if (e->writes_i) {
+    // mov word [rbx + I], r15w
+    emit8(e, 0x66);
+    rex(e, false, REG_I, RBX);
+    emit8(e, 0x89);
+    modrm_c8(e, REG_I, OFF_I);
+  }
+  // mov word [rbx + PC], imm16
+  emit8(e, 0x66);
+  emit8(e, 0xC7);
+  modrm_c8(e, 0, OFF_PC);
+  emit8(e, pc);
+  emit8(e, pc >> 8);
+  pop(e, R15);
+  pop(e, R14);
+  pop(e, R13);
+  pop(e, R12);
+  pop(e, RBP);
+  pop(e, RBX);
+  emit8(e, 0xC3); // ret
+}
+
+// skip next instruction when the flags say so (je/jne), else fall through.
+// pc is already past the skip op, len is what skip_len() gives there
+static void skip_exit(emit_t *e, const uint8_t cc, const uint16_t pc,
+                      const uint16_t len) {
+  uint8_t *skip = jcc(e, cc);
+  exit_to(e, pc);
+  patch_here(e, skip);
+  exit_to(e, pc + len);
+}
+
+// translate one op, PC = pc is the address of the next instruction and
+// skip how far a skip op jumps from there. the quirks are settled here, the
+// emitted code never tests them
+static void emit_op(emit_t *e, const uint16_t op, const uint16_t pc,
+                    const uint16_t skip, const quirks_t q) {
+  const uint8_t x = e->host[OP_X(op)], y = e->host[OP_Y(op)];
+  const uint8_t f = e->host[0xF];
+  const uint16_t wx = 1u << OP_X(op), wf = 1u << 0xF;
+
+  switch (op >> 12) {
+  case 0x1:
+    exit_to(e, OP_NNN(op));
+    return;
+  case 0x3:
+    alu8_imm(e, 7, x, OP_NN(op));
+    skip_exit(e, 0x84, pc, skip); // je
+    return;
+  case 0x4:
+    alu8_imm(e, 7, x, OP_NN(op));
+    skip_exit(e, 0x85, pc, skip); // jne
+    return;
+  case 0x5:
+    alu8(e, 0x38, x, y);
+    skip_exit(e, 0x84, pc, skip);
+    return;
+  case 0x9:
+    alu8(e, 0x38, x, y);
+    skip_exit(e, 0x85, pc, skip);
+    return;
+  case 0x6:
+    mov_imm32(e, x, OP_NN(op));
+    e->written |= wx;
+    return;
+  case 0x7:
+    alu8_imm(e, 0, x, OP_NN(op));
+    e->written |= wx;
+    return;
+  case 0x8:
+    switch (OP_N(op)) {
+    case 0x0:
+      alu8(e, 0x88, x, y);
+      e->written |= wx;
+      return;
+    case 0x1:
+    case 0x2:
+    case 0x3: {
+      // or / and / xor, then the VF reset
+      static const uint8_t opc[] = {0, 0x08, 0x20, 0x30};
+      alu8(e, opc[OP_N(op)], x, y);
+      e->written |= wx;
+      if (q.vf_reset) {
+        mov_imm32(e, f, 0);
+        e->written |= wf;
+      }
+      return;
+    }
+    case 0x4:
+      // VF = carry out of the 8 bit add
+      alu8(e, 0x00, x, y);
+      setcc(e, 0x92, f);
+      e->written |= wx | wf;
+      return;
+    case 0x5:
+      // VF = no borrow
+      alu8(e, 0x28, x, y);
+      setcc(e, 0x93, f);
+      e->written |= wx | wf;
+      return;
+    case 0x6:
+      // VX = VY >> 1 (or VX >> 1), VF = bit shifted out. VF is written last
+      alu8(e, 0x88, RAX, q.shift_vx ? x : y);
+      shift1(e, 5, RAX);
+      setcc(e, 0x92, RDX);
+      alu8(e, 0x88, x, RAX);
+      alu8(e, 0x88, f, RDX);
+      e->written |= wx | wf;
+      return;
+    case 0x7:
+      // VX = VY - VX, VF = no borrow
+      alu8(e, 0x88, RAX, y);
+      alu8(e, 0x28, RAX, x);
+      setcc(e, 0x93, RDX);
+      alu8(e, 0x88, x, RAX);
+      alu8(e, 0x88, f, RDX);
+      e->written |= wx | wf;
+      return;
+    case 0xE:
+      // VX = VY << 1 (or VX << 1), VF = bit shifted out
+      alu8(e, 0x88, RAX, q.shift_vx ? x : y);
+      shift1(e, 4, RAX);
+      setcc(e, 0x92, RDX);
+      alu8(e, 0x88, x, RAX);
+      alu8(e, 0x88, f, RDX);
+      e->written |= wx | wf;
+      return;
+    }
+    return;
+  case 0xA:
+    mov_imm32(e, REG_I, OP_NNN(op));
+    e->writes_i = true;
+    return;
+  case 0xF:
+    switch (OP_NN(op)) {
+    case 0x07:
+      // mov x8, byte [rbx + delay_timer]
+      rex(e, false, x, RBX);
+      emit8(e, 0x8A);
+      modrm_c8(e, x, OFF_DT);
+      e->written |= wx;
+      return;
+    case 0x15:
+    case 0x18:
+      // mov byte [rbx + timer], x8
+      rex(e, false, x, RBX);
+      emit8(e, 0x88);
+      modrm_c8(e, x, OP_NN(op) == 0x15 ? OFF_DT : OFF_ST);
+      return;
+    case 0x1E:
+      // I += VX, 16 bits wide
+      movzx8(e, RAX, x);
+      // add r15d, eax
+      rex(e, false, RAX, REG_I);
+      emit8(e, 0x01);
+      modrm_reg(e, RAX, REG_I);
+      // movzx r15d, r15w
+      rex(e, false, REG_I, REG_I);
+      emit8(e, 0x0F);
+      emit8(e, 0xB7);
+      modrm_reg(e, REG_I, REG_I);
+      if (q.i_overflow) {
+        // cmp r15d, 0xFFF then VF = seta
+        rex(e, false, 0, REG_I);
+        emit8(e, 0x81);
+        modrm_reg(e, 7, REG_I);
+        emit32(e, 0x0FFF);
+        setcc(e, 0x97, f);
+        e->written |= wf;
+      }
+      e->writes_i = true;
+      return;
+    case 0x29:
+      // lea r15d, [rax + rax * 4]
+      movzx8(e, RAX, x);
+      emit8(e, 0x44);
+      emit8(e, 0x8D);
+      emit8(e, 0x04 | (REG_I & 7) << 3);
+      emit8(e, 0x80);
+      e->writes_i = true;
+      return;
+    }
+    return;
+  }
+  // 0NNN and 8XYN holes are no-ops
+}
+
+// only flip the pages the next block can land on, the whole arena is
+// far too slow to mprotect on every compile
+static bool protect(jit_t *jit, const int prot) {
+  const size_t page = 4096;
+  const size_t start = jit->used & ~(page - 1);
+  size_t end = (jit->used + JIT_WORST + page - 1) & ~(page - 1);
+  if (end > jit->size)
+    end = jit->size;
+  return mprotect(jit->arena + start, end - start, prot) == 0;
+}
+
+static void flush(jit_t *jit) {
+  memset(jit->blocks, 0, sizeof jit->blocks);
+  jit->code_pages = 0;
+  jit->used = 0;
+  jit->flushes++;
+}
+
+// translate from pc. leaves the block JIT_INTERP if not even the first op
+// can be translated
+static void compile(jit_t *jit, const chip8_t *c8, const uint16_t start,
+                    const quirks_t q) {
+  jit_block_t *b = &jit->blocks[start];
+  emit_t e = {.written = 0};
+  memset(e.host, -1, sizeof e.host);
+
+  // pass 1: how far can we go, and which registers are needed
+  uint16_t pc = start;
+  uint16_t regs = 0;
+  uint8_t n_regs = 0;
+  uint8_t len = 0;
+  uint64_t pages = 0;
+  while (b->strikes < JIT_STRIKES && len < JIT_MAX &&
+         pc + 1u < CODE_SIZE) {
+    const uint16_t op = fetch(c8, pc);
+    uint16_t r;
+    bool uses_i, ends;
+    if (!translatable(op, q, &r, &uses_i, &ends))
+      break;
+    const uint16_t add = r & ~regs;
+    if (n_regs + (uint32_t)__builtin_popcount(add) > sizeof pool)
+      break; // out of host registers, end the block here
+    for (uint8_t v = 0; v < 16; v++)
+      if (add & (1u << v))
+        e.host[v] = pool[n_regs++];
+    regs |= add;
+    e.uses_i |= uses_i;
+    pages |= 1ull << (pc >> RAM_PAGE_SHIFT);
+    pages |= 1ull << ((pc + 1) >> RAM_PAGE_SHIFT);
+    pc += 2;
+    len++;
+    if (ends)
+      break;
+  }
+  if (len > 0 && pc + 1u < CODE_SIZE) {
+    // a skip's length depends on the op after it (F000 NNNN)
+    pages |= 1ull << (pc >> RAM_PAGE_SHIFT);
+    pages |= 1ull << ((pc + 1) >> RAM_PAGE_SHIFT);
+  }
+  if (len == 0) {
+    b->state = JIT_INTERP;
+    b->pages = 1ull << (start >> RAM_PAGE_SHIFT);
+    b->pages |= 1ull << ((start + 1) >> RAM_PAGE_SHIFT);
+    jit->code_pages |= b->pages;
+    return;
+  }
+
+  if (jit->used + JIT_WORST > jit->size)
+    flush(jit);
+  b->pages = pages;
+  jit->code_pages |= pages;
+
+  // pass 2: emit
+  if (!protect(jit, PROT_READ | PROT_WRITE)) {
+    b->state = JIT_INTERP;
+    return;
+  }
+  e.p = jit->arena + jit->used;
+  uint8_t *const entry = e.p;
+  prologue(&e);
+  pc = start;
+  bool ended = false;
+  for (uint8_t i = 0; i < len; i++) {
+    const uint16_t op = fetch(c8, pc);
+    uint16_t r;
+    bool uses_i;
+    pc += 2;
+    translatable(op, q, &r, &uses_i, &ended);
+    emit_op(&e, op, pc, fetch(c8, pc) == 0xF000 ? 4 : 2, q);
+  }
+  if (!ended)
+    exit_to(&e, pc); // fell off the end, continue at the next op
+  protect(jit, PROT_READ | PROT_EXEC);
+
+  jit->used += e.p - entry;
+  jit->used = (jit->used + 15) & ~(size_t)15;
+  b->fn = (jit_fn)(void *)entry;
+  b->len = len;
+  b->state = JIT_NATIVE;
+  jit->compiled++;
+}
+
+// drop blocks decoded from the written pages. a block can start up to
+// JIT_MAX ops before the page it reaches into, so only that window is
+// scanned. code_pages is left as a superset, it only gates the scan
+static void invalidate(jit_t *jit, uint64_t pages) {
+  pages &= jit->code_pages;
+  while (pages) {
+    const uint32_t page = __builtin_ctzll(pages);
+    pages &= pages - 1;
+    const int32_t first = (int32_t)(page << RAM_PAGE_SHIFT) - 2 * JIT_MAX;
+    const uint32_t last = (page + 1) << RAM_PAGE_SHIFT;
+    for (uint32_t pc = first < 0 ? 0 : first; pc < last; pc++) {
+      jit_block_t *b = &jit->blocks[pc];
+      if (b->state == JIT_EMPTY || !(b->pages & (1ull << page)))
+        continue;
+      b->state = JIT_EMPTY; // code stays in the arena until the next flush
+      if (b->strikes < JIT_STRIKES)
+        b->strikes++;
+      jit->invalidations++;
+    }
+  }
+}
+
+jit_t *new_jit(void) {
+  jit_t *jit = calloc(1, sizeof(jit_t));
+  if (!jit)
+    return NULL;
+  jit->size = ARENA_SIZE;
+  jit->arena = mmap(NULL, jit->size, PROT_READ | PROT_EXEC,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (jit->arena == MAP_FAILED) {
+    fprintf(stderr, "Failed to map JIT arena!\n");
+    free(jit);
+    return NULL;
+  }
+  return jit;
+}
+
+void free_jit(jit_t *jit) {
+  if (!jit)
+    return;
+  munmap(jit->arena, jit->size);
+  free(jit);
+}
+
+// native blocks when they fit in the budget, the interpreter otherwise
+uint32_t jit_run(jit_t *jit, chip8_t *c8, const config_t config,
+                 const uint32_t n) {
+  const quirks_t q = profile_quirks(config.quirks);
+  uint32_t executed = 0;
+  while (executed < n && c8->state == RUNNING) {
+    if (c8->dirty_pages) {
+      invalidate(jit, c8->dirty_pages);
+      c8->dirty_pages = 0;
+    }
+    if (c8->PC + 1u < CODE_SIZE) {
+      jit_block_t *b = &jit->blocks[c8->PC];
+      if (b->state == JIT_EMPTY)
+        compile(jit, c8, c8->PC, q);
+      // a block must not run past the frame, the timers tick in between
+      if (b->state == JIT_NATIVE && b->len <= n - executed) {
+        b->fn(c8);
+        executed += b->len;
+        jit->native += b->len;
+        continue;
+      }
+    }
+    executed += dispatch_run(c8, config, 1);
+    jit->interpreted++;
+  }
+  return executed;
+}
+
+#else // no x86-64, nothing to translate to
+
+jit_t *new_jit(void) {
+  fprintf(stderr, "JIT needs an x86-64 host!\n");
+  return NULL;
+}
+
+void free_jit(jit_t *jit) { (void)jit; }
+
+uint32_t jit_run(jit_t *jit, chip8_t *c8, const config_t config,
+                 const uint32_t n) {
+  (void)jit;
+  return dispatch_run(c8, config, n);
+}
+
+#endif
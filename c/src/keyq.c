@@ -0,0 +1,85 @@
+#include "../include/keyq.h"
+#include <stdio.h>
+
+static void apply(key_queue_t *q, chip8_t *c8, const key_event_t ev) {
+  c8->keys[ev.key] = ev.down;
+  if (ev.down && q->n_unshown < KEYQ_SIZE)
+    q->unshown[q->n_unshown++] = ev.ns; // timed once it is on screen
+}
+
+// queue an event, a full queue applies its oldest one right away
+void key_push(key_queue_t *q, chip8_t *c8, const key_event_t ev) {
+  if (q->tail - q->head == KEYQ_SIZE)
+    apply(q, c8, q->events[q->head++ % KEYQ_SIZE]);
+  q->events[q->tail++ % KEYQ_SIZE] = ev;
+}
+
+// apply everything queued now, for frames that do not run (paused,
+// rewinding) and recordings, which only hold keys per frame
+void key_flush(key_queue_t *q, chip8_t *c8) {
+  while (q->head != q->tail)
+    apply(q, c8, q->events[q->head++ % KEYQ_SIZE]);
+}
+
+// run a whole frame standing for the wall time [from, to). each event is
+// applied at the instruction matching its timestamp, so short taps are
+// not lost and presses keep their order against what the rom runs.
+// from == to applies everything before the first instruction
+uint32_t run_frame_keys(key_queue_t *q, scheduler_t *s, chip8_t *c8,
+                        const config_t config, const uint64_t from,
+                        const uint64_t to) {
+  uint32_t executed = run_frame(s, c8, config, 0); // starts the frame
+  const uint32_t total = s->pending;
+  while (q->head != q->tail && s->in_frame && c8->state == RUNNING) {
+    const key_event_t ev = q->events[q->head % KEYQ_SIZE];
+    const uint32_t at =
+        ev.ns <= from || to <= from ? 0
+        : ev.ns >= to               ? total
+                      : (uint32_t)((ev.ns - from) * total / (to - from));
+    const uint32_t done = total - s->pending;
+    if (at > done) {
+      executed += run_frame(s, c8, config, at - done);
+      continue;
+    }
+    apply(q, c8, ev);
+    q->head++;
+  }
+  key_flush(q, c8); // the frame ended early (quit, pause)
+  if (s->in_frame && c8->state == RUNNING)
+    executed += run_frame(s, c8, config, UINT32_MAX);
+  return executed;
+}
+
+// a frame was just shown, the n presses it saw have reached the screen
+void key_presented(key_latency_t *l, const uint64_t *pressed, const uint32_t n,
+                   const uint64_t now) {
+  for (uint32_t i = 0; i < n; i++) {
+    const uint64_t ns = now > pressed[i] ? now - pressed[i] : 0;
+    const uint64_t ms = ns / 1000000;
+    l->latency[ms < LATENCY_BUCKETS ? ms : LATENCY_BUCKETS - 1]++;
+    l->presses++;
+    l->latency_ns += ns;
+    if (ns > l->max_ns)
+      l->max_ns = ns;
+  }
+}
+
+// ms below which a share of the presses were shown
+static uint32_t percentile(const key_latency_t *l, const double share) {
+  uint64_t seen = 0;
+  for (uint32_t ms = 0; ms < LATENCY_BUCKETS; ms++) {
+    seen += l->latency[ms];
+    if (seen >= share * l->presses)
+      return ms + 1;
+  }
+  return LATENCY_BUCKETS;
+}
+
+void print_key_latency(const key_latency_t *l) {
+  if (l->presses == 0)
+    return;
+  printf("input: %llu presses, input to present %.2fms mean, p50 <%ums, "
+         "p99 <%ums, max %.2fms\n",
+         (unsigned long long)l->presses, l->latency_ns / 1e6 / l->presses,
+         percentile(l, 0.5), percentile(l, 0.99), l->max_ns / 1e6);
+}
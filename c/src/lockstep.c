@@ -0,0 +1,402 @@
+#include "../include/lockstep.h"
+#include "../include/dispatch.h"
+#include "../include/emulator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// LANE_CHUNK lanes of 8 and 16 bit registers, sse sized and avx2 sized
+typedef uint8_t lane_u8 __attribute__((vector_size(LANE_CHUNK)));
+typedef int8_t lane_i8 __attribute__((vector_size(LANE_CHUNK)));
+typedef uint16_t lane_u16 __attribute__((vector_size(LANE_CHUNK * 2)));
+typedef int16_t lane_i16 __attribute__((vector_size(LANE_CHUNK * 2)));
+
+#define U8(p, c) (*(lane_u8 *)&(p)[(c)])
+#define U16(p, c) (*(lane_u16 *)&(p)[(c)])
+#define SEL(m, a, b) (((a) & (m)) | ((b) & ~(m)))
+// byte lane mask (0/0xFF) or compare result to a 16 bit lane mask
+#define WIDEN(m) ((lane_u16)__builtin_convertvector((lane_i8)(m), lane_i16))
+#define ZEXT(v) __builtin_convertvector((v), lane_u16)
+
+// build the vector kernels for avx2 and baseline, picked at load time
+#if defined(__x86_64__) && defined(__GNUC__)
+#define LANE_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define LANE_CLONES
+#endif
+
+static void *lane_alloc(const uint32_t padded, const size_t size) {
+  void *p = aligned_alloc(64, (padded * size + 63) & ~(size_t)63);
+  if (p)
+    memset(p, 0, padded * size);
+  return p;
+}
+
+bool init_lockstep(lockstep_t *ls, const chip8_t *proto, uint32_t lanes) {
+  memset(ls, 0, sizeof *ls);
+  ls->lanes = lanes;
+  ls->padded = (lanes + LANE_CHUNK - 1) / LANE_CHUNK * LANE_CHUNK;
+
+  bool ok = true;
+  for (int x = 0; x < 16; x++)
+    ok &= (ls->V[x] = lane_alloc(ls->padded, 1)) != NULL;
+  ok &= (ls->I = lane_alloc(ls->padded, 2)) != NULL;
+  ok &= (ls->PC = lane_alloc(ls->padded, 2)) != NULL;
+  ok &= (ls->delay_timer = lane_alloc(ls->padded, 1)) != NULL;
+  ok &= (ls->sound_timer = lane_alloc(ls->padded, 1)) != NULL;
+  ok &= (ls->op = lane_alloc(ls->padded, 2)) != NULL;
+  ok &= (ls->mask = lane_alloc(ls->padded, 1)) != NULL;
+  ok &= (ls->pending = lane_alloc(ls->padded, 1)) != NULL;
+  ok &= (ls->c8 = calloc(lanes, sizeof(chip8_t))) != NULL;
+  if (!ok) {
+    fprintf(stderr, "Could not allocate %u lockstep lanes.\n", lanes);
+    free_lockstep(ls);
+    return false;
+  }
+
+  for (uint32_t l = 0; l < lanes; l++) {
+    chip8_t *c8 = &ls->c8[l];
+    *c8 = *proto;
+    c8->SP = c8->stack + (proto->SP - proto->stack); // own stack
+    for (int x = 0; x < 16; x++)
+      ls->V[x][l] = proto->V[x];
+    ls->I[l] = proto->I;
+    ls->PC[l] = proto->PC;
+    ls->delay_timer[l] = proto->delay_timer;
+    ls->sound_timer[l] = proto->sound_timer;
+    c8->dirty_pages = 0; // set again once this lane writes ram
+  }
+  ls->shared_ram = true;
+  return true;
+}
+
+void free_lockstep(lockstep_t *ls) {
+  for (int x = 0; x < 16; x++)
+    free(ls->V[x]);
+  free(ls->I);
+  free(ls->PC);
+  free(ls->delay_timer);
+  free(ls->sound_timer);
+  free(ls->op);
+  free(ls->mask);
+  free(ls->pending);
+  free(ls->c8);
+  memset(ls, 0, sizeof *ls);
+}
+
+// copy the SoA registers of one lane back into its chip8_t
+chip8_t *lockstep_lane(lockstep_t *ls, uint32_t lane) {
+  chip8_t *c8 = &ls->c8[lane];
+  for (int x = 0; x < 16; x++)
+    c8->V[x] = ls->V[x][lane];
+  c8->I = ls->I[lane];
+  c8->PC = ls->PC[lane];
+  c8->delay_timer = ls->delay_timer[lane];
+  c8->sound_timer = ls->sound_timer[lane];
+  return c8;
+}
+
+// one instruction on one lane through the reference interpreter
+static void step_lane(lockstep_t *ls, const uint32_t l, const config_t config) {
+  chip8_t *c8 = lockstep_lane(ls, l);
+  emulator(c8, config);
+  for (int x = 0; x < 16; x++)
+    ls->V[x][l] = c8->V[x];
+  ls->I[l] = c8->I;
+  ls->PC[l] = c8->PC;
+  ls->delay_timer[l] = c8->delay_timer;
+  ls->sound_timer[l] = c8->sound_timer;
+  if (c8->dirty_pages)
+    ls->shared_ram = false; // this lane's ram may differ from now on
+  ls->scalar_ops++;
+}
+
+// opcodes that only touch V, I, PC and the timers, everything else needs
+// the lane's ram, stack, keys, display or rng
+static bool vector_op(const uint16_t op) {
+  switch (op >> 12) {
+  case 0x0:
+    return decode_op(op, QUIRKS_CHIP8) == op_nop;
+  case 0x5:
+    return OP_N(op) != 2 && OP_N(op) != 3; // xo-chip save/load use ram
+  case 0x1:
+  case 0x3:
+  case 0x4:
+  case 0x6:
+  case 0x7:
+  case 0x9:
+  case 0xA:
+    return true;
+  case 0x8:
+    return OP_N(op) <= 0x7 || OP_N(op) == 0xE;
+  case 0xF:
+    switch (OP_NN(op)) {
+    case 0x07:
+    case 0x15:
+    case 0x18:
+    case 0x1E:
+    case 0x29:
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
+
+// run op on every lane in ls->mask, chunks first..last. same semantics as
+// the op_xxxx functions in ops.h, written as masked selects. VF is
+// reloaded after VX is stored so X == F ends the same way. the quirks are
+// tested once per group, not per lane
+LANE_CLONES static void run_group(lockstep_t *ls, const uint16_t op,
+                                  const uint32_t first, const uint32_t last,
+                                  const quirks_t q) {
+  const uint8_t x = OP_X(op), y = OP_Y(op), nn = OP_NN(op);
+  const uint16_t nnn = OP_NNN(op);
+  uint8_t *vf = ls->V[0xF];
+
+  for (uint32_t c = first; c <= last; c += LANE_CHUNK) {
+    const lane_u8 m = U8(ls->mask, c);
+    const lane_u16 m16 = WIDEN(m);
+    const lane_u8 vx = U8(ls->V[x], c);
+    const lane_u8 vy = U8(ls->V[y], c);
+    lane_u16 pc = U16(ls->PC, c) + (2 & m16);
+    lane_u8 r, carry;
+
+    switch (op >> 12) {
+    case 0x1:
+      pc = SEL(m16, nnn, pc);
+      break;
+    case 0x3:
+      pc += 2 & m16 & WIDEN(vx == nn);
+      break;
+    case 0x4:
+      pc += 2 & m16 & WIDEN(vx != nn);
+      break;
+    case 0x5:
+      pc += 2 & m16 & WIDEN(vx == vy);
+      break;
+    case 0x9:
+      pc += 2 & m16 & WIDEN(vx != vy);
+      break;
+    case 0x6:
+      U8(ls->V[x], c) = SEL(m, nn, vx);
+      break;
+    case 0x7:
+      U8(ls->V[x], c) = vx + (nn & m);
+      break;
+    case 0xA:
+      U16(ls->I, c) = SEL(m16, nnn, U16(ls->I, c));
+      break;
+    case 0x8:
+      switch (OP_N(op)) {
+      case 0x0:
+        U8(ls->V[x], c) = SEL(m, vy, vx);
+        break;
+      case 0x1:
+      case 0x2:
+      case 0x3:
+        r = OP_N(op) == 1 ? (vx | vy) : OP_N(op) == 2 ? (vx & vy) : (vx ^ vy);
+        U8(ls->V[x], c) = SEL(m, r, vx);
+        if (q.vf_reset)
+          U8(vf, c) &= ~m;
+        break;
+      case 0x4:
+        r = vx + vy;
+        carry = (lane_u8)(r < vx) & 1;
+        U8(ls->V[x], c) = SEL(m, r, vx);
+        U8(vf, c) = SEL(m, carry, U8(vf, c));
+        break;
+      case 0x5:
+        carry = (lane_u8)(vy <= vx) & 1;
+        U8(ls->V[x], c) = SEL(m, vx - vy, vx);
+        U8(vf, c) = SEL(m, carry, U8(vf, c));
+        break;
+      case 0x6:
+        r = q.shift_vx ? vx : vy;
+        U8(ls->V[x], c) = SEL(m, r >> 1, vx);
+        U8(vf, c) = SEL(m, r & 1, U8(vf, c));
+        break;
+      case 0x7:
+        carry = (lane_u8)(vx <= vy) & 1;
+        U8(ls->V[x], c) = SEL(m, vy - vx, vx);
+        U8(vf, c) = SEL(m, carry, U8(vf, c));
+        break;
+      case 0xE:
+        r = q.shift_vx ? vx : vy;
+        U8(ls->V[x], c) = SEL(m, r << 1, vx);
+        U8(vf, c) = SEL(m, r >> 7, U8(vf, c));
+        break;
+      }
+      break;
+    case 0xF:
+      switch (nn) {
+      case 0x07:
+        U8(ls->V[x], c) = SEL(m, U8(ls->delay_timer, c), vx);
+        break;
+      case 0x15:
+        U8(ls->delay_timer, c) = SEL(m, vx, U8(ls->delay_timer, c));
+        break;
+      case 0x18:
+        U8(ls->sound_timer, c) = SEL(m, vx, U8(ls->sound_timer, c));
+        break;
+      case 0x1E: {
+        const lane_u16 i = U16(ls->I, c) + (ZEXT(vx) & m16);
+        U16(ls->I, c) = i;
+        if (q.i_overflow) {
+          carry = (lane_u8)__builtin_convertvector(i > 0xFFF, lane_i8) & 1;
+          U8(vf, c) = SEL(m, carry, U8(vf, c));
+        }
+        break;
+      }
+      case 0x29:
+        U16(ls->I, c) = SEL(m16, ZEXT(vx) * 5, U16(ls->I, c));
+        break;
+      }
+      break;
+    }
+    U16(ls->PC, c) = pc;
+  }
+}
+
+// mark the pending lanes at pc in ls->mask and take them off pending,
+// returns how many there were and the last lane index that may be set
+LANE_CLONES static uint32_t group_by_pc(lockstep_t *ls, const uint32_t lead,
+                                       const uint16_t pc, uint32_t *last) {
+  uint32_t count = 0;
+  for (uint32_t c = lead / LANE_CHUNK * LANE_CHUNK; c < ls->padded;
+       c += LANE_CHUNK) {
+    const lane_i16 same = U16(ls->PC, c) == pc;
+    const lane_u8 m =
+        (lane_u8)__builtin_convertvector(same, lane_i8) & U8(ls->pending, c);
+    U8(ls->mask, c) = m;
+    U8(ls->pending, c) &= ~m;
+
+    uint64_t w[2];
+    memcpy(w, &m, sizeof w);
+    if (w[0] | w[1]) {
+      count += (__builtin_popcountll(w[0]) + __builtin_popcountll(w[1])) / 8;
+      *last = c + LANE_CHUNK - 1;
+    }
+  }
+  if (*last >= ls->lanes)
+    *last = ls->lanes - 1;
+  return count;
+}
+
+// once lanes wrote ram, the same pc can hold different opcodes (self
+// modifying code). drop lanes whose fetched opcode is not op back to
+// pending, returns how many were dropped
+static uint32_t split_by_op(lockstep_t *ls, const uint32_t lead,
+                            const uint32_t last, const uint16_t op) {
+  uint32_t dropped = 0;
+  for (uint32_t l = lead; l <= last; l++) {
+    if (ls->mask[l] && ls->op[l] != op) {
+      ls->mask[l] = 0;
+      ls->pending[l] = 0xFF;
+      dropped++;
+    }
+  }
+  return dropped;
+}
+
+// does a skip in the group have to step over F000 NNNN? run_group only
+// skips 2 bytes, those lanes go through emulator()
+static bool long_skip(const lockstep_t *ls, const uint16_t op,
+                      const uint32_t lead, const uint32_t last) {
+  const uint8_t kind = op >> 12;
+  if (kind != 0x3 && kind != 0x4 && kind != 0x5 && kind != 0x9)
+    return false;
+  const uint16_t next = ls->PC[lead] + 2;
+  if (ls->shared_ram)
+    return fetch(&ls->c8[lead], next) == 0xF000;
+  for (uint32_t l = lead; l <= last; l++)
+    if (ls->mask[l] && fetch(&ls->c8[l], next) == 0xF000)
+      return true;
+  return false;
+}
+
+static uint32_t next_pending(const lockstep_t *ls, uint32_t l) {
+  while (l < ls->lanes && !ls->pending[l])
+    l++;
+  return l;
+}
+
+// one instruction on every lane. the first pending lane leads, every lane
+// at the same PC fetching the same opcode joins its group and the group
+// runs as one vector op. while all lanes still have identical ram the
+// same PC means the same opcode and the per lane fetch is skipped
+void lockstep_step(lockstep_t *ls, const config_t config) {
+  const quirks_t q = profile_quirks(config.quirks);
+  const uint32_t n = ls->lanes;
+  const bool shared = ls->shared_ram;
+  // lanes that quit (00FD, a stack fault) are never stepped again, like
+  // emulator_run() stops on them
+  for (uint32_t l = 0; l < n; l++)
+    ls->pending[l] = ls->c8[l].state == RUNNING ? 0xFF : 0;
+  if (!shared) {
+    for (uint32_t l = 0; l < n; l++) {
+      ls->op[l] = fetch(&ls->c8[l], ls->PC[l]);
+    }
+  }
+
+  for (uint32_t lead = next_pending(ls, 0); lead < n;
+       lead = next_pending(ls, lead + 1)) {
+    const uint16_t pc = ls->PC[lead];
+    const uint16_t op = fetch(&ls->c8[lead], pc);
+
+    uint32_t last = lead;
+    uint32_t count = group_by_pc(ls, lead, pc, &last);
+    if (!shared)
+      count -= split_by_op(ls, lead, last, op);
+
+    // a group of one is cheaper as a plain scalar step
+    if (count > 1 && vector_op(op) && !long_skip(ls, op, lead, last)) {
+      run_group(ls, op, lead / LANE_CHUNK * LANE_CHUNK, last, q);
+      ls->vector_ops += count;
+      ls->groups++;
+      continue;
+    }
+    for (uint32_t l = lead; l <= last; l++)
+      if (ls->mask[l])
+        step_lane(ls, l, config);
+  }
+}
+
+// lanes that wrote the same bytes to ram (same score, same bcd) can share
+// the fast path again. only pages some lane wrote need comparing
+static void rejoin_ram(lockstep_t *ls) {
+  uint64_t pages = 0;
+  for (uint32_t l = 0; l < ls->lanes; l++)
+    pages |= ls->c8[l].dirty_pages;
+
+  for (uint32_t l = 1; l < ls->lanes; l++) {
+    for (uint64_t p = pages; p; p &= p - 1) {
+      const uint32_t page = __builtin_ctzll(p);
+      const uint32_t at = page << RAM_PAGE_SHIFT;
+      // the last page also stands for xo-chip ram past 4K
+      const uint32_t len = page == 63 ? RAM_SIZE - at : 1u << RAM_PAGE_SHIFT;
+      if (memcmp(ls->c8[l].ram + at, ls->c8[0].ram + at, len) != 0)
+        return;
+    }
+  }
+  for (uint32_t l = 0; l < ls->lanes; l++)
+    ls->c8[l].dirty_pages = 0;
+  ls->shared_ram = true;
+}
+
+// 60hz tick on every lane, update_timers() as a vector op
+LANE_CLONES static void tick_timers(lockstep_t *ls) {
+  for (uint32_t c = 0; c < ls->padded; c += LANE_CHUNK) {
+    const lane_u8 d = U8(ls->delay_timer, c);
+    const lane_u8 s = U8(ls->sound_timer, c);
+    U8(ls->delay_timer, c) = d + (lane_u8)(d != 0); // true is -1
+    U8(ls->sound_timer, c) = s + (lane_u8)(s != 0);
+  }
+}
+
+// end of a 60hz frame: timers, and try to get back on the shared ram path
+void lockstep_end_frame(lockstep_t *ls) {
+  tick_timers(ls);
+  if (!ls->shared_ram)
+    rejoin_ram(ls);
+}
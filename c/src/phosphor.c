@@ -0,0 +1,115 @@
+#include "../include/phosphor.h"
+#include "../include/scheduler.h"
+#include <string.h>
+
+// PHOSPHOR_CHUNK pixels as bytes, 16 bit and 32 bit lanes
+typedef uint8_t px_u8 __attribute__((vector_size(PHOSPHOR_CHUNK)));
+typedef uint16_t px_u16 __attribute__((vector_size(PHOSPHOR_CHUNK * 2)));
+typedef int16_t px_i16 __attribute__((vector_size(PHOSPHOR_CHUNK * 2)));
+typedef uint32_t px_u32 __attribute__((vector_size(PHOSPHOR_CHUNK * 4)));
+
+// build the row kernel for avx2 and baseline, picked at load time
+#if defined(__x86_64__) && defined(__GNUC__)
+#define PX_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define PX_CLONES
+#endif
+
+// the bit of a 16 pixel slice each lane tests, x 0 in the MSB
+static const px_u16 px_bit = {
+    1u << 15, 1u << 14, 1u << 13, 1u << 12, 1u << 11, 1u << 10,
+    1u << 9,  1u << 8,  1u << 7,  1u << 6,  1u << 5,  1u << 4,
+    1u << 3,  1u << 2,  1u << 1,  1u << 0,
+};
+
+// RGBA8888 (config) -> ARGB8888 (texture)
+static uint32_t to_argb(const uint32_t rgba) {
+  return (rgba >> 8) | (rgba << 24);
+}
+
+void init_phosphor(phosphor_t *ph, const config_t config) {
+  memset(ph, 0, sizeof *ph);
+  ph->palette[0] = to_argb(config.bcolor);
+  ph->palette[1] = to_argb(config.fcolor);
+  ph->palette[2] = to_argb(config.color2);
+  ph->palette[3] = to_argb(config.color3);
+  ph->keep = config.phosphor >= 100 ? 255 : config.phosphor * 256 / 100;
+  ph->factor = 256;
+}
+
+// decay the ticks since the last call and return the rows that have to
+// be drawn: the ones the rom changed and, when a tick went by, the ones
+// still fading. a mode switch starts over from the new screen
+uint64_t phosphor_advance(phosphor_t *ph, const chip8_t *c8,
+                          const uint64_t now) {
+  const uint64_t tick = 1000000000ull / TIMER_HZ;
+  const uint64_t ticks = ph->tick_ns ? (now - ph->tick_ns) / tick : 1;
+  ph->tick_ns = ph->tick_ns ? ph->tick_ns + ticks * tick : now;
+  // with no persistence an erased pixel is gone on the next present,
+  // even one inside the same tick
+  ph->factor = ph->keep ? 256 : 0;
+  for (uint64_t t = 0; t < ticks && ph->factor; t++)
+    ph->factor = ph->factor * ph->keep >> 8;
+
+  const uint32_t height = screen_height(c8);
+  const uint64_t screen = height == 64 ? ALL_ROWS : (1ull << height) - 1;
+  if (c8->hires != ph->hires) {
+    memset(ph->level, 0, sizeof ph->level);
+    ph->fading = 0;
+    ph->hires = c8->hires;
+    return screen;
+  }
+  return (c8->dirty_rows | (ph->factor < 256 ? ph->fading : 0)) & screen;
+}
+
+// decay, light and colour row y into dst, PHOSPHOR_CHUNK pixels per step.
+// settled pixels come out as the exact palette colours
+PX_CLONES void phosphor_row(phosphor_t *ph, const chip8_t *c8,
+                            const uint32_t y, uint32_t *dst) {
+  const uint32_t width = screen_width(c8);
+  const uint16_t factor = ph->factor;
+  // by channel, B G R A: background, plane 1 - background, plane 2 and
+  // both - plane 2
+  int16_t bg[4], d1[4], c2[4], d3[4];
+  for (uint32_t k = 0; k < 4; k++) {
+    bg[k] = ph->palette[0] >> 8 * k & 0xFF;
+    d1[k] = (ph->palette[1] >> 8 * k & 0xFF) - bg[k];
+    c2[k] = ph->palette[2] >> 8 * k & 0xFF;
+    d3[k] = (ph->palette[3] >> 8 * k & 0xFF) - c2[k];
+  }
+  px_u16 fading = {0};
+  for (uint32_t x = 0; x < width; x += PHOSPHOR_CHUNK) {
+    px_i16 in[2];
+    for (uint32_t p = 0; p < 2; p++) {
+      const uint16_t bits =
+          get_row(c8, p, y) >> (DISPLAY_WIDTH - PHOSPHOR_CHUNK - x);
+      const px_u16 lit = (px_u16)((bits & px_bit) != 0);
+      px_u8 now;
+      memcpy(&now, &ph->level[p][y][x], sizeof now);
+      px_u16 level = __builtin_convertvector(now, px_u16) * factor >> 8;
+      level = (level & ~lit) | (255 & lit);
+      fading |= level & ~lit;
+      now = __builtin_convertvector(level, px_u8);
+      memcpy(&ph->level[p][y][x], &now, sizeof now);
+      in[p] = (px_i16)((level + (level >> 7)) >> 1); // 0-128
+    }
+    // each channel of the palette blended by both plane levels, packed
+    // two channels to a 16 bit lane before widening
+    px_u16 ch[4];
+    for (uint32_t k = 0; k < 4; k++) {
+      const px_i16 a = bg[k] + (d1[k] * in[0] >> 7);
+      const px_i16 b = c2[k] + (d3[k] * in[0] >> 7);
+      ch[k] = (px_u16)(a + ((b - a) * in[1] >> 7));
+    }
+    const px_u32 argb = __builtin_convertvector(ch[0] | ch[1] << 8, px_u32) |
+                        __builtin_convertvector(ch[2] | ch[3] << 8, px_u32)
+                            << 16;
+    memcpy(dst + x, &argb, sizeof argb);
+  }
+  uint64_t any[sizeof fading / 8];
+  memcpy(any, &fading, sizeof any);
+  uint64_t left = 0;
+  for (uint32_t i = 0; i < sizeof any / 8; i++)
+    left |= any[i];
+  ph->fading = (ph->fading & ~(1ull << y)) | (uint64_t)(left != 0) << y;
+}
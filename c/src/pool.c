@@ -0,0 +1,131 @@
+#include "../include/pool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// a worker's jobs are [head, tail), packed so the owner (taking from the
+// head) and thieves (taking from the tail) agree through a single CAS
+typedef struct Deque {
+  _Alignas(64) _Atomic uint64_t range; // own cache line, no false sharing
+} deque_t;
+
+typedef struct Pool {
+  deque_t *deques;
+  uint32_t n_threads;
+  pool_fn fn;
+  void *ctx;
+} pool_t;
+
+typedef struct Worker {
+  pool_t *pool;
+  uint32_t id;
+} worker_t;
+
+#define PACK(head, tail) ((uint64_t)(head) << 32 | (tail))
+#define HEAD(range) ((uint32_t)((range) >> 32))
+#define TAIL(range) ((uint32_t)(range))
+
+// owner end
+static bool pop(deque_t *d, uint32_t *job) {
+  uint64_t r = atomic_load(&d->range);
+  while (HEAD(r) < TAIL(r)) {
+    if (atomic_compare_exchange_weak(&d->range, &r,
+                                     PACK(HEAD(r) + 1, TAIL(r)))) {
+      *job = HEAD(r);
+      return true;
+    }
+  }
+  return false;
+}
+
+// thief end, takes the back half (at least one job)
+static bool steal(deque_t *victim, uint32_t *first, uint32_t *last) {
+  uint64_t r = atomic_load(&victim->range);
+  while (HEAD(r) < TAIL(r)) {
+    const uint32_t left = TAIL(r) - HEAD(r);
+    const uint32_t split = TAIL(r) - (left + 1) / 2;
+    if (atomic_compare_exchange_weak(&victim->range, &r,
+                                     PACK(HEAD(r), split))) {
+      *first = split;
+      *last = TAIL(r);
+      return true;
+    }
+  }
+  return false;
+}
+
+static void *work(void *arg) {
+  worker_t *w = arg;
+  pool_t *p = w->pool;
+  deque_t *own = &p->deques[w->id];
+  uint32_t job, first, last;
+
+  for (;;) {
+    while (pop(own, &job))
+      p->fn(p->ctx, job, w->id);
+
+    // dry, go looking. jobs are never added, so one empty pass = done
+    bool found = false;
+    for (uint32_t i = 1; i < p->n_threads && !found; i++) {
+      deque_t *victim = &p->deques[(w->id + i) % p->n_threads];
+      if (steal(victim, &first, &last)) {
+        // run the first one now, publish the rest for others to steal
+        atomic_store(&own->range, PACK(first + 1, last));
+        p->fn(p->ctx, first, w->id);
+        found = true;
+      }
+    }
+    if (!found)
+      return NULL;
+  }
+}
+
+uint32_t pool_default_threads(void) {
+  const long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? n : 1;
+}
+
+bool pool_run(const uint32_t n_jobs, uint32_t n_threads, const pool_fn fn,
+              void *ctx) {
+  if (n_threads == 0)
+    n_threads = pool_default_threads();
+  if (n_threads > n_jobs)
+    n_threads = n_jobs ? n_jobs : 1;
+
+  pool_t pool = {.n_threads = n_threads, .fn = fn, .ctx = ctx};
+  pool.deques = aligned_alloc(64, n_threads * sizeof(deque_t));
+  pthread_t *threads = calloc(n_threads, sizeof(pthread_t));
+  worker_t *workers = calloc(n_threads, sizeof(worker_t));
+  if (!pool.deques || !threads || !workers) {
+    fprintf(stderr, "Failed to allocate thread pool!\n");
+    free(pool.deques);
+    free(threads);
+    free(workers);
+    return false;
+  }
+
+  // even split up front, stealing evens out the long jobs
+  for (uint32_t i = 0; i < n_threads; i++) {
+    const uint32_t head = (uint64_t)n_jobs * i / n_threads;
+    const uint32_t tail = (uint64_t)n_jobs * (i + 1) / n_threads;
+    atomic_init(&pool.deques[i].range, PACK(head, tail));
+    workers[i] = (worker_t){.pool = &pool, .id = i};
+  }
+
+  // worker 0 is this thread
+  uint32_t started = 1;
+  for (; started < n_threads; started++) {
+    if (pthread_create(&threads[started], NULL, work, &workers[started]))
+      break; // the remaining deques get stolen from
+  }
+  work(&workers[0]);
+  for (uint32_t i = 1; i < started; i++)
+    pthread_join(threads[i], NULL);
+
+  free(pool.deques);
+  free(threads);
+  free(workers);
+  return true;
+}
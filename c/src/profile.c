@@ -0,0 +1,224 @@
+#include "../include/profile.h"
+#include "../include/engine.h"
+#include "../include/hash.h"
+#include "../include/scheduler.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// opcode classes, first match wins
+typedef struct OpClass {
+  uint16_t mask;
+  uint16_t value;
+  const char *name;
+} op_class_t;
+
+static const op_class_t op_classes[] = {
+    {0xFFFF, 0x00E0, "00E0"}, {0xFFFF, 0x00EE, "00EE"},
+    {0xFFF0, 0x00C0, "00CN"}, {0xFFF0, 0x00D0, "00DN"},
+    {0xFFFF, 0x00FB, "00FB"}, {0xFFFF, 0x00FC, "00FC"},
+    {0xFFFF, 0x00FD, "00FD"}, {0xFFFF, 0x00FE, "00FE"},
+    {0xFFFF, 0x00FF, "00FF"}, {0xF000, 0x0000, "0NNN"},
+    {0xF000, 0x1000, "1NNN"}, {0xF000, 0x2000, "2NNN"},
+    {0xF000, 0x3000, "3XNN"}, {0xF000, 0x4000, "4XNN"},
+    {0xF00F, 0x5002, "5XY2"}, {0xF00F, 0x5003, "5XY3"},
+    {0xF000, 0x5000, "5XY0"}, {0xF000, 0x6000, "6XNN"},
+    {0xF000, 0x7000, "7XNN"}, {0xF00F, 0x8000, "8XY0"},
+    {0xF00F, 0x8001, "8XY1"}, {0xF00F, 0x8002, "8XY2"},
+    {0xF00F, 0x8003, "8XY3"}, {0xF00F, 0x8004, "8XY4"},
+    {0xF00F, 0x8005, "8XY5"}, {0xF00F, 0x8006, "8XY6"},
+    {0xF00F, 0x8007, "8XY7"}, {0xF00F, 0x800E, "8XYE"},
+    {0xF000, 0x8000, "8XY?"}, {0xF000, 0x9000, "9XY0"},
+    {0xF000, 0xA000, "ANNN"}, {0xF000, 0xB000, "BNNN"},
+    {0xF000, 0xC000, "CXNN"}, {0xF000, 0xD000, "DXYN"},
+    {0xF0FF, 0xE09E, "EX9E"}, {0xF0FF, 0xE0A1, "EXA1"},
+    {0xF000, 0xE000, "EX??"}, {0xF0FF, 0xF007, "FX07"},
+    {0xF0FF, 0xF00A, "FX0A"}, {0xF0FF, 0xF015, "FX15"},
+    {0xF0FF, 0xF018, "FX18"}, {0xF0FF, 0xF01E, "FX1E"},
+    {0xF0FF, 0xF029, "FX29"}, {0xF0FF, 0xF033, "FX33"},
+    {0xF0FF, 0xF055, "FX55"}, {0xF0FF, 0xF065, "FX65"},
+    {0xFFFF, 0xF000, "F000"}, {0xF0FF, 0xF001, "FN01"},
+    {0xFFFF, 0xF002, "F002"}, {0xF0FF, 0xF030, "FX30"},
+    {0xF0FF, 0xF03A, "FX3A"}, {0xF0FF, 0xF075, "FX75"},
+    {0xF0FF, 0xF085, "FX85"}, {0xF000, 0xF000, "FX??"},
+};
+
+#define N_CLASSES (sizeof op_classes / sizeof *op_classes)
+static_assert(N_CLASSES <= 64, "profile_t.classes is too small");
+
+static const char *section_names[PROF_SECTIONS] = {"emulation", "input",
+                                                   "render", "waiting"};
+
+static uint32_t op_class(const uint16_t op) {
+  uint32_t c = 0;
+  while ((op & op_classes[c].mask) != op_classes[c].value)
+    c++; // the last F entry catches everything left
+  return c;
+}
+
+profile_t *new_profile(void) {
+  profile_t *p = calloc(1, sizeof(profile_t));
+  if (!p) {
+    fprintf(stderr, "Could not allocate the profiler.\n");
+    return NULL;
+  }
+  p->countdown = PROFILE_PERIOD;
+  return p;
+}
+
+void free_profile(profile_t *p) { free(p); }
+
+// the subroutine each return address on the stack came from: the 2NNN
+// just before it names the entry point
+static void sample_stack(profile_t *p, const chip8_t *c8) {
+  profile_stack_t s = {.depth = c8->SP - c8->stack};
+  for (uint8_t i = 0; i < s.depth; i++) {
+    const uint16_t call = (c8->stack[i] - 2) & 0xFFF;
+    s.calls[i] = (c8->ram[call] << 8 | c8->ram[(call + 1) & 0xFFF]) & 0x0FFF;
+  }
+
+  uint64_t h = fnv1a(FNV_OFFSET, s.calls, s.depth * sizeof *s.calls);
+  for (uint32_t probe = 0; probe < 16; probe++) {
+    profile_stack_t *slot = &p->stacks[(h + probe) % PROFILE_STACKS];
+    if (slot->samples == 0) {
+      *slot = s;
+    } else if (slot->depth != s.depth ||
+               memcmp(slot->calls, s.calls, s.depth * sizeof *s.calls) != 0) {
+      continue;
+    }
+    slot->samples++;
+    return;
+  }
+  p->other_stacks++;
+}
+
+static void sample(profile_t *p, const chip8_t *c8) {
+  const uint16_t pc = c8->PC & 0xFFF;
+  const uint16_t op = c8->ram[pc] << 8 | c8->ram[(pc + 1) & 0xFFF];
+  p->samples++;
+  p->pc[pc]++;
+  p->classes[op_class(op)]++;
+  sample_stack(p, c8);
+}
+
+// engine_run() in slices that end on sample points
+uint32_t profile_run(profile_t *p, engine_t *e, chip8_t *c8,
+                     const config_t config, const uint32_t n) {
+  uint32_t executed = 0;
+  while (executed < n) {
+    const uint32_t left = n - executed;
+    const uint32_t slice = left < p->countdown ? left : p->countdown;
+    const uint32_t ran = engine_run(e, c8, config, slice);
+    executed += ran;
+    p->countdown -= ran;
+    if (p->countdown == 0) {
+      sample(p, c8);
+      p->countdown = PROFILE_PERIOD;
+    }
+    if (ran == 0)
+      break;
+  }
+  return executed;
+}
+
+// charge the time since *since to section and restart the clock there.
+// does nothing without a profile, so callers don't need to check
+void profile_time(profile_t *p, const profile_section_t section,
+                  uint64_t *since) {
+  if (!p)
+    return;
+  const uint64_t now = now_ns();
+  p->ns[section] += now - *since;
+  *since = now;
+}
+
+static const uint64_t *sort_counts; // what by_samples orders by
+
+static int by_samples(const void *a, const void *b) {
+  const uint16_t x = *(const uint16_t *)a, y = *(const uint16_t *)b;
+  const uint64_t *c = sort_counts;
+  return c[y] > c[x] ? 1 : c[y] < c[x] ? -1 : x - y;
+}
+
+static void write_report(FILE *out, const profile_t *p, const chip8_t *c8) {
+  const double total = p->samples ? (double)p->samples : 1.0;
+  fprintf(out, "profile of %s: %llu samples, one every %u instructions\n\n",
+          c8->rom_name, (unsigned long long)p->samples, PROFILE_PERIOD);
+
+  uint64_t ns = 0;
+  for (int s = 0; s < PROF_SECTIONS; s++)
+    ns += p->ns[s];
+  fprintf(out, "time\n");
+  for (int s = 0; s < PROF_SECTIONS; s++)
+    fprintf(out, "  %-10s %10.3f ms  %5.1f%%\n", section_names[s],
+            p->ns[s] / 1e6, ns ? 100.0 * p->ns[s] / ns : 0.0);
+
+  fprintf(out, "\nDXYN\n  %llu draws, %llu pixels, %llu collisions (%.1f%%)\n",
+          (unsigned long long)p->draws, (unsigned long long)p->pixels,
+          (unsigned long long)p->collisions,
+          p->draws ? 100.0 * p->collisions / p->draws : 0.0);
+
+  uint16_t order[4096];
+  fprintf(out, "\nopcode classes\n");
+  for (uint16_t c = 0; c < N_CLASSES; c++)
+    order[c] = c;
+  sort_counts = p->classes;
+  qsort(order, N_CLASSES, sizeof *order, by_samples);
+  for (uint16_t i = 0; i < N_CLASSES && p->classes[order[i]]; i++)
+    fprintf(out, "  %-6s %5.1f%%  %llu\n", op_classes[order[i]].name,
+            100.0 * p->classes[order[i]] / total,
+            (unsigned long long)p->classes[order[i]]);
+
+  fprintf(out, "\nhotspots\n  addr   share  samples  opcode\n");
+  for (uint16_t a = 0; a < 4096; a++)
+    order[a] = a;
+  sort_counts = p->pc;
+  qsort(order, 4096, sizeof *order, by_samples);
+  for (int i = 0; i < 4096 && p->pc[order[i]]; i++) {
+    const uint16_t a = order[i];
+    const uint16_t op = c8->ram[a] << 8 | c8->ram[(a + 1) & 0xFFF];
+    fprintf(out, "  0x%03X %5.1f%%  %7llu  %04X %s\n", a,
+            100.0 * p->pc[a] / total, (unsigned long long)p->pc[a], op,
+            op_classes[op_class(op)].name);
+  }
+}
+
+// one line per call stack, `main;sub_2A4;sub_310 42`, what flamegraph.pl
+// and speedscope read
+static void write_folded(FILE *out, const profile_t *p) {
+  for (uint32_t i = 0; i < PROFILE_STACKS; i++) {
+    const profile_stack_t *s = &p->stacks[i];
+    if (s->samples == 0)
+      continue;
+    fprintf(out, "main");
+    for (uint8_t d = 0; d < s->depth; d++)
+      fprintf(out, ";sub_%03X", s->calls[d]);
+    fprintf(out, " %llu\n", (unsigned long long)s->samples);
+  }
+  if (p->other_stacks)
+    fprintf(out, "main;[other] %llu\n", (unsigned long long)p->other_stacks);
+}
+
+// PREFIX.txt gets the report, PREFIX.folded the collapsed stacks
+bool write_profile(const profile_t *p, const chip8_t *c8, const char *prefix) {
+  char path[1024];
+  snprintf(path, sizeof path, "%s.txt", prefix);
+  FILE *report = fopen(path, "w");
+  snprintf(path, sizeof path, "%s.folded", prefix);
+  FILE *folded = fopen(path, "w");
+  if (!report || !folded) {
+    fprintf(stderr, "Failed to open %s.txt/.folded for writing.\n", prefix);
+    if (report)
+      fclose(report);
+    if (folded)
+      fclose(folded);
+    return false;
+  }
+  write_report(report, p, c8);
+  write_folded(folded, p);
+  const bool ok = (fclose(report) == 0) & (fclose(folded) == 0);
+  if (!ok)
+    fprintf(stderr, "Could not write profile %s.\n", prefix);
+  return ok;
+}
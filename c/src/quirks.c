@@ -0,0 +1,35 @@
+#include "../include/quirks.h"
+#include <stdint.h>
+#include <string.h>
+
+static const char *const names[] = {
+#define X(id, name, ...) [QUIRKS_##id] = #name,
+    QUIRK_PROFILES(X)
+#undef X
+};
+
+static const quirks_t quirks[] = {
+#define X(id, name, ...) [QUIRKS_##id] = {__VA_ARGS__},
+    QUIRK_PROFILES(X)
+#undef X
+};
+
+// for code that reads the quirks once up front (jit codegen, lockstep)
+// instead of being instantiated per profile
+quirks_t profile_quirks(const quirk_profile_t profile) {
+  return quirks[profile];
+}
+
+const char *quirks_name(const quirk_profile_t profile) {
+  return names[profile];
+}
+
+bool parse_quirks(const char *name, quirk_profile_t *profile) {
+  for (uint32_t i = 0; i < QUIRK_COUNT; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      *profile = i;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,187 @@
+#include "../include/replay.h"
+#include "../include/chip8.h"
+#include "../include/hash.h"
+#include "../include/le.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPLAY_HEADER (4 + 2 + 2 + 8 + 4 + 4 + 4 + 4)
+
+// start recording c8 as it is now, right after init_c8 and seed_c8
+bool init_replay(replay_t *rp, const chip8_t *c8, const config_t config) {
+  *rp = (replay_t){
+      .rom_hash = c8->rom_hash,
+      .seed = c8->rng,
+      .ips = config.ips,
+      .quirks = config.quirks,
+  };
+  return true;
+}
+
+void free_replay(replay_t *rp) {
+  free(rp->keys);
+  memset(rp, 0, sizeof *rp);
+}
+
+// keys held for the frame about to run
+bool replay_capture(replay_t *rp, const chip8_t *c8) {
+  if (rp->frames == rp->cap) {
+    const uint32_t cap = rp->cap ? rp->cap * 2 : 4096;
+    uint16_t *grown = realloc(rp->keys, cap * sizeof *grown);
+    if (!grown) {
+      fprintf(stderr, "Out of memory recording input.\n");
+      return false;
+    }
+    rp->keys = grown;
+    rp->cap = cap;
+  }
+  uint16_t mask = 0;
+  for (int k = 0; k < 16; k++)
+    mask |= c8->keys[k] << k;
+  rp->keys[rp->frames++] = mask;
+  return true;
+}
+
+// frames undone by rewind are not part of the recording
+void replay_drop(replay_t *rp, const uint32_t frames) {
+  rp->frames = frames < rp->frames ? rp->frames - frames : 0;
+}
+
+// keys for the next frame, false once the recording is used up
+bool replay_feed(replay_t *rp, chip8_t *c8) {
+  if (rp->pos >= rp->frames)
+    return false;
+  const uint16_t mask = rp->keys[rp->pos++];
+  for (int k = 0; k < 16; k++)
+    c8->keys[k] = (mask >> k) & 1;
+  return true;
+}
+
+bool save_replay(const replay_t *rp, const char *path) {
+  // runs of the same mask, a run never spans more than 65535 frames
+  uint32_t runs = 0;
+  for (uint32_t f = 0, len = 0; f < rp->frames; f++, len++) {
+    if (f == 0 || rp->keys[f] != rp->keys[f - 1] || len == UINT16_MAX) {
+      runs++;
+      len = 0;
+    }
+  }
+
+  const size_t size = REPLAY_HEADER + runs * 4 + 8;
+  uint8_t *buf = malloc(size);
+  if (!buf) {
+    fprintf(stderr, "Out of memory saving %s.\n", path);
+    return false;
+  }
+  uint8_t *p = buf;
+  memcpy(p, REPLAY_MAGIC, 4);
+  p = put_le(p + 4, REPLAY_VERSION, 2);
+  p = put_le(p, rp->quirks, 2);
+  p = put_le(p, rp->rom_hash, 8);
+  p = put_le(p, rp->seed, 4);
+  p = put_le(p, rp->ips, 4);
+  p = put_le(p, rp->frames, 4);
+  p = put_le(p, runs, 4);
+  for (uint32_t f = 0; f < rp->frames;) {
+    uint32_t len = 1;
+    while (f + len < rp->frames && rp->keys[f + len] == rp->keys[f] &&
+           len < UINT16_MAX)
+      len++;
+    p = put_le(p, rp->keys[f], 2);
+    p = put_le(p, len, 2);
+    f += len;
+  }
+  p = put_le(p, fnv1a(FNV_OFFSET, buf, p - buf), 8);
+
+  FILE *f = fopen(path, "wb");
+  bool ok = f && fwrite(buf, size, 1, f) == 1;
+  if (f && fclose(f) != 0)
+    ok = false;
+  if (!ok)
+    fprintf(stderr, "Could not write replay %s.\n", path);
+  free(buf);
+  return ok;
+}
+
+// read a recording made against the rom c8 has loaded
+bool load_replay(replay_t *rp, const chip8_t *c8, const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "Failed to open %s.\n", path);
+    return false;
+  }
+  fseek(f, 0, SEEK_END);
+  const long size = ftell(f);
+  rewind(f);
+  uint8_t *buf = size > 0 ? malloc(size) : NULL;
+  const bool read = buf && fread(buf, size, 1, f) == 1;
+  fclose(f);
+  if (!read || size < REPLAY_HEADER + 8 ||
+      memcmp(buf, REPLAY_MAGIC, 4) != 0) {
+    fprintf(stderr, "%s is not a replay.\n", path);
+    free(buf);
+    return false;
+  }
+
+  const uint8_t *p = buf + 4;
+  const uint8_t *sum = buf + size - 8;
+  const uint16_t version = get_le(&p, 2);
+  memset(rp, 0, sizeof *rp);
+  rp->quirks = get_le(&p, 2);
+  rp->rom_hash = get_le(&p, 8);
+  rp->seed = get_le(&p, 4);
+  rp->ips = get_le(&p, 4);
+  const uint32_t frames = get_le(&p, 4);
+  const uint32_t runs = get_le(&p, 4);
+
+  const char *err = NULL;
+  if (version != REPLAY_VERSION)
+    err = "unsupported version";
+  else if (rp->quirks >= QUIRK_COUNT)
+    err = "unknown quirk profile";
+  else if ((size_t)size != REPLAY_HEADER + (size_t)runs * 4 + 8)
+    err = "truncated";
+  else if (get_le(&sum, 8) != fnv1a(FNV_OFFSET, buf, size - 8))
+    err = "checksum mismatch";
+  else if (rp->rom_hash != c8->rom_hash)
+    err = "recorded with a different rom";
+  else if (!(rp->keys = malloc((frames ? frames : 1) * sizeof *rp->keys)))
+    err = "out of memory";
+
+  for (uint32_t r = 0; !err && r < runs; r++) {
+    const uint16_t mask = get_le(&p, 2);
+    const uint16_t len = get_le(&p, 2);
+    if (rp->frames + len > frames) {
+      err = "more frames than the header says";
+      break;
+    }
+    for (uint16_t i = 0; i < len; i++)
+      rp->keys[rp->frames++] = mask;
+  }
+  free(buf);
+  if (!err && rp->frames != frames)
+    err = "fewer frames than the header says";
+  if (err) {
+    fprintf(stderr, "Replay %s: %s.\n", path, err);
+    free_replay(rp);
+    return false;
+  }
+  rp->cap = frames;
+  return true;
+}
+
+// play the whole recording back flat out. the caller seeds c8 and sets
+// config.ips and config.quirks from the recording first
+uint64_t run_replay(replay_t *rp, scheduler_t *s, chip8_t *c8,
+                    const config_t config, capture_t *cap) {
+  const uint64_t start = s->cycles;
+  while (c8->state == RUNNING && replay_feed(rp, c8)) {
+    do
+      run_frame(s, c8, config, UINT32_MAX);
+    while (s->in_frame && c8->state == RUNNING);
+    if (cap)
+      capture_frame(cap, c8);
+  }
+  return s->cycles - start;
+}
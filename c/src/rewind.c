@@ -0,0 +1,266 @@
+#include "../include/rewind.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static_assert(sizeof(rewind_snap_t) % sizeof(uint64_t) == 0,
+              "rewind_snap_t is compared as words");
+static_assert(TIMER_HZ <= 256, "rewind_snap_t keeps the budget in a byte");
+static_assert(sizeof(((rewind_snap_t *)0)->display) ==
+                  sizeof(((chip8_t *)0)->display),
+              "rewind_snap_t holds the whole display");
+
+// token header: words of zeros, then words of literals that follow it
+typedef struct RunHeader {
+  uint16_t zeros;
+  uint16_t literals;
+} run_header_t;
+
+#define SKIP_WORDS 64 // words pack() compares at once while nothing changed
+
+// worst case, every other word zero
+#define PACK_MAX (SNAP_WORDS * (sizeof(run_header_t) + sizeof(uint64_t)))
+
+bool init_rewind(rewind_t *rw, const uint32_t seconds) {
+  memset(rw, 0, sizeof *rw);
+  rw->cap = (seconds + 1) * 60; // eviction drops a keyframe's second at once
+  rw->size = (size_t)seconds * REWIND_BYTES_PER_SEC;
+  if (rw->size < 4 * PACK_MAX)
+    rw->size = 4 * PACK_MAX; // always room for a keyframe and its deltas
+  rw->data = malloc(rw->size);
+  rw->entries = calloc(rw->cap, sizeof(rewind_entry_t));
+  rw->scratch = malloc(PACK_MAX);
+  if (!rw->data || !rw->entries || !rw->scratch || rw->cap == 0) {
+    fprintf(stderr, "Could not allocate %u seconds of rewind.\n", seconds);
+    free_rewind(rw);
+    return false;
+  }
+  return true;
+}
+
+void free_rewind(rewind_t *rw) {
+  free(rw->data);
+  free(rw->entries);
+  free(rw->scratch);
+  memset(rw, 0, sizeof *rw);
+}
+
+static void capture(rewind_snap_t *s, const chip8_t *c8,
+                    const scheduler_t *sched) {
+  memcpy(s->display, c8->display, sizeof s->display);
+  s->rng = c8->rng;
+  memcpy(s->stack, c8->stack, sizeof s->stack);
+  s->I = c8->I;
+  s->PC = c8->PC;
+  memcpy(s->ram, c8->ram, sizeof s->ram);
+  memcpy(s->V, c8->V, sizeof s->V);
+  memcpy(s->flags, c8->flags, sizeof s->flags);
+  memcpy(s->pattern, c8->pattern, sizeof s->pattern);
+  s->depth = c8->SP - c8->stack;
+  s->delay_timer = c8->delay_timer;
+  s->sound_timer = c8->sound_timer;
+  s->wait_key = c8->wait_key;
+  s->mode = c8->hires | c8->planes << 1 | c8->xo_audio << 3;
+  s->pitch = c8->pitch;
+  s->budget = sched->budget;
+  memset(s->spare, 0, sizeof s->spare);
+}
+
+// the scheduler too: the instructions per frame alternate (11, 12, 12 at
+// 700 ips), a replay only matches if they go on from the same place
+static void restore(chip8_t *c8, scheduler_t *sched, const rewind_snap_t *s) {
+  memcpy(c8->display, s->display, sizeof c8->display);
+  c8->rng = s->rng;
+  memcpy(c8->stack, s->stack, sizeof c8->stack);
+  c8->I = s->I;
+  c8->PC = s->PC;
+  memcpy(c8->ram, s->ram, sizeof c8->ram);
+  memcpy(c8->V, s->V, sizeof c8->V);
+  memcpy(c8->flags, s->flags, sizeof c8->flags);
+  memcpy(c8->pattern, s->pattern, sizeof c8->pattern);
+  c8->SP = c8->stack + s->depth;
+  c8->delay_timer = s->delay_timer;
+  c8->sound_timer = s->sound_timer;
+  c8->wait_key = s->wait_key;
+  c8->hires = s->mode & 1;
+  c8->planes = s->mode >> 1 & 3;
+  c8->xo_audio = s->mode >> 3 & 1;
+  c8->pitch = s->pitch;
+  c8->dirty_rows = ~0ull;  // redraw everything
+  c8->dirty_pages = ~0ull; // cached decodes may be from the future
+  sched->budget = s->budget;
+  sched->pending = 0;
+  sched->in_frame = false; // snapshots are taken between frames
+}
+
+// word i of a snapshot, XORed against base when given
+static inline uint64_t snap_word(const rewind_snap_t *snap,
+                                 const rewind_snap_t *base, const size_t i) {
+  uint64_t w, b = 0;
+  memcpy(&w, (const uint8_t *)snap + i * sizeof w, sizeof w);
+  if (base)
+    memcpy(&b, (const uint8_t *)base + i * sizeof b, sizeof b);
+  return w ^ b;
+}
+
+// run length encode words (XORed against base when given), zero words are
+// only counted. one pass, most of a frame is 64K of unchanged ram. returns
+// the encoded length
+static uint32_t pack(uint8_t *out, const rewind_snap_t *snap,
+                     const rewind_snap_t *base) {
+  uint8_t *p = out;
+  for (size_t i = 0; i < SNAP_WORDS;) {
+    run_header_t run = {0};
+    // unchanged stretches a block at a time, memcmp is vectorised
+    while (base && i + SKIP_WORDS <= SNAP_WORDS &&
+           memcmp((const uint64_t *)snap + i, (const uint64_t *)base + i,
+                  SKIP_WORDS * sizeof(uint64_t)) == 0) {
+      run.zeros += SKIP_WORDS;
+      i += SKIP_WORDS;
+    }
+    while (i < SNAP_WORDS && snap_word(snap, base, i) == 0) {
+      run.zeros++;
+      i++;
+    }
+    uint8_t *lits = p + sizeof run;
+    uint64_t w;
+    while (i < SNAP_WORDS && (w = snap_word(snap, base, i)) != 0) {
+      memcpy(lits + run.literals * sizeof w, &w, sizeof w);
+      run.literals++;
+      i++;
+    }
+    memcpy(p, &run, sizeof run);
+    p = lits + run.literals * sizeof(uint64_t);
+  }
+  return p - out;
+}
+
+// inverse of pack, XORs into snap (start from the base or from zero)
+static void unpack(rewind_snap_t *snap, const uint8_t *in, const uint32_t len) {
+  uint64_t w[SNAP_WORDS];
+  memcpy(w, snap, sizeof w);
+  const uint8_t *end = in + len;
+  size_t i = 0;
+  while (in < end) {
+    run_header_t run;
+    memcpy(&run, in, sizeof run);
+    in += sizeof run;
+    i += run.zeros;
+    for (uint32_t k = 0; k < run.literals; k++, i++, in += sizeof(uint64_t)) {
+      uint64_t lit;
+      memcpy(&lit, in, sizeof lit);
+      w[i] ^= lit;
+    }
+  }
+  memcpy(snap, w, sizeof w);
+}
+
+static rewind_entry_t *entry(rewind_t *rw, const uint32_t i) {
+  return &rw->entries[(rw->first + i) % rw->cap];
+}
+
+// drop the oldest entry, then any deltas left without their keyframe
+static void evict(rewind_t *rw) {
+  do {
+    rw->first = (rw->first + 1) % rw->cap;
+    rw->count--;
+  } while (rw->count > 0 && !entry(rw, 0)->keyframe);
+}
+
+// find len contiguous bytes in the ring, evicting from the oldest end
+static size_t reserve(rewind_t *rw, const uint32_t len) {
+  while (rw->count > 0) {
+    const size_t oldest = entry(rw, 0)->offset;
+    if (rw->head > oldest) {
+      if (rw->size - rw->head >= len)
+        return rw->head;
+      rw->head = 0; // not enough tail left, wrap
+    } else if (oldest - rw->head >= len) {
+      return rw->head;
+    } else {
+      evict(rw);
+    }
+  }
+  rw->head = 0;
+  return 0;
+}
+
+void rewind_record(rewind_t *rw, const chip8_t *c8, const scheduler_t *s) {
+  if (rw->cap == 0)
+    return; // rewind is off
+  const uint64_t start = now_ns();
+  if (rw->count == rw->cap)
+    evict(rw);
+
+  capture(&rw->snap, c8, s);
+  bool keyframe = rw->count == 0 || rw->since_key >= REWIND_KEYFRAME;
+  uint32_t len = pack(rw->scratch, &rw->snap, keyframe ? NULL : &rw->key);
+  size_t at = reserve(rw, len);
+  if (!keyframe && rw->count == 0) {
+    // making room evicted our keyframe, this frame has to be one
+    keyframe = true;
+    len = pack(rw->scratch, &rw->snap, NULL);
+    at = reserve(rw, len);
+  }
+  memcpy(rw->data + at, rw->scratch, len);
+  rw->head = at + len;
+
+  *entry(rw, rw->count++) = (rewind_entry_t){at, len, keyframe};
+  if (keyframe) {
+    rw->key = rw->snap;
+    rw->since_key = 0;
+  }
+  rw->since_key++;
+
+  rw->frames++;
+  rw->raw_bytes += sizeof(rewind_snap_t);
+  rw->packed_bytes += len;
+  rw->record_ns += now_ns() - start;
+}
+
+// make the keyframe of the newest entry the XOR base again
+static void load_base(rewind_t *rw) {
+  uint32_t i = rw->count;
+  while (i > 0 && !entry(rw, i - 1)->keyframe)
+    i--;
+  if (i == 0)
+    return; // nothing left, next record is a keyframe
+  const rewind_entry_t *key = entry(rw, i - 1);
+  memset(&rw->key, 0, sizeof rw->key);
+  unpack(&rw->key, rw->data + key->offset, key->len);
+  rw->since_key = rw->count - (i - 1);
+}
+
+// drop the newest frame (where c8 is now) and restore the one before it,
+// so holding rewind walks back a frame per call and recording carries on
+// from there. returns false once only the oldest frame is left
+bool rewind_step(rewind_t *rw, chip8_t *c8, scheduler_t *s) {
+  if (rw->cap == 0 || rw->count < 2)
+    return false;
+  const rewind_entry_t *newest = entry(rw, rw->count - 1);
+  rw->head = newest->offset; // newest is always the last allocation
+  rw->count--;
+  if (newest->keyframe)
+    load_base(rw);
+  else
+    rw->since_key--;
+
+  const rewind_entry_t *e = entry(rw, rw->count - 1);
+  rw->snap = rw->key;
+  if (e->keyframe)
+    memset(&rw->snap, 0, sizeof rw->snap);
+  unpack(&rw->snap, rw->data + e->offset, e->len);
+  restore(c8, s, &rw->snap);
+  return true;
+}
+
+void print_rewind_stats(const rewind_t *rw) {
+  if (rw->frames == 0)
+    return;
+  printf("rewind: %u frames held (%.1fs), %zu KB ring, %.1fx smaller, "
+         "%.2fus per frame recorded\n",
+         rw->count, rw->count / 60.0, rw->size / 1024,
+         rw->packed_bytes ? (double)rw->raw_bytes / rw->packed_bytes : 0.0,
+         rw->record_ns / 1e3 / rw->frames);
+}
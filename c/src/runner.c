@@ -0,0 +1,284 @@
+#include "../include/runner.h"
+#include "../include/profile.h"
+#include "../include/savestate.h"
+#include "../include/trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// quick save slot sits next to the rom
+static void state_path(const chip8_t *c8, char *path, const size_t len) {
+  snprintf(path, len, "%s.state", c8->rom_name);
+}
+
+// frontend side: queue a command and wake the emulation thread if it is
+// sleeping. never waits, a full ring drops the command
+void runner_command(runner_t *r, const command_t cmd) {
+  const uint32_t tail =
+      atomic_load_explicit(&r->cmd_tail, memory_order_relaxed);
+  const uint32_t head =
+      atomic_load_explicit(&r->cmd_head, memory_order_acquire);
+  if (tail - head == RUNNER_COMMANDS) {
+    r->lost++;
+    return;
+  }
+  r->commands[tail & (RUNNER_COMMANDS - 1)] = cmd;
+  atomic_store_explicit(&r->cmd_tail, tail + 1, memory_order_release);
+  sem_post(&r->wake);
+}
+
+static bool pending_commands(runner_t *r) {
+  return atomic_load_explicit(&r->cmd_head, memory_order_relaxed) !=
+         atomic_load_explicit(&r->cmd_tail, memory_order_acquire);
+}
+
+static void apply_command(runner_t *r, const command_t cmd) {
+  chip8_t *c8 = r->c8;
+  char path[1024];
+  switch (cmd.kind) {
+  case CMD_KEY:
+    key_push(&r->keys, c8, cmd.key);
+    break;
+  case CMD_PAUSE:
+    if (c8->state == RUNNING)
+      c8->state = PAUSED;
+    else if (c8->state == PAUSED)
+      c8->state = RUNNING;
+    break;
+  case CMD_REWIND:
+    if (cmd.on && c8->state == RUNNING)
+      c8->state = REWINDING; // until released
+    else if (!cmd.on && c8->state == REWINDING)
+      c8->state = RUNNING;
+    break;
+  case CMD_SAVE:
+    state_path(c8, path, sizeof path);
+    if (save_state_file(c8, path))
+      printf("State saved to %s\n", path);
+    break;
+  case CMD_LOAD:
+    state_path(c8, path, sizeof path);
+    if (load_state_file(c8, path))
+      printf("State loaded from %s\n", path);
+    break;
+  case CMD_TRACE:
+    if (c8->trace && flush_trace(c8->trace))
+      printf("Trace written to %s\n", c8->trace->path);
+    break;
+  case CMD_QUIT:
+    c8->state = QUIT;
+    break;
+  }
+}
+
+static void drain_commands(runner_t *r) {
+  uint32_t head = atomic_load_explicit(&r->cmd_head, memory_order_relaxed);
+  const uint32_t tail =
+      atomic_load_explicit(&r->cmd_tail, memory_order_acquire);
+  for (; head != tail; head++)
+    apply_command(r, r->commands[head & (RUNNER_COMMANDS - 1)]);
+  atomic_store_explicit(&r->cmd_head, head, memory_order_release);
+}
+
+// hand the display over: draw into the back slot, then swap it with the
+// middle one. if the reader never took the old middle, that frame is
+// dropped: it is taken back and drawn over, so this one still carries its
+// dirty rows and presses to the reader
+static void publish(runner_t *r) {
+  chip8_t *c8 = r->c8;
+  uint32_t old = atomic_load_explicit(&r->middle, memory_order_acquire);
+  const bool carry = (old & FRAME_FRESH) &&
+                     atomic_compare_exchange_strong_explicit(
+                         &r->middle, &old, r->back, memory_order_acq_rel,
+                         memory_order_acquire);
+  if (carry)
+    r->back = old & 3; // the back slot went to the middle, not fresh
+  frame_t *f = &r->frames[r->back];
+  if (!carry) {
+    f->dirty_rows = 0;
+    f->n_pressed = 0;
+    f->paced = true;
+  }
+  memcpy(f->display, c8->display, sizeof f->display);
+  f->hires = c8->hires;
+  f->dirty_rows |= c8->dirty_rows;
+  c8->dirty_rows = 0;
+  for (uint32_t i = 0; i < r->keys.n_unshown && f->n_pressed < KEYQ_SIZE; i++)
+    f->pressed[f->n_pressed++] = r->keys.unshown[i];
+  r->keys.n_unshown = 0;
+  f->paced &= !r->unpaced;
+  r->unpaced = false;
+  f->seq = r->published++;
+
+  // the reader never takes a slot that is not fresh, nothing to carry
+  r->back = atomic_exchange_explicit(&r->middle, r->back | FRAME_FRESH,
+                                     memory_order_acq_rel) &
+            3;
+  if (r->on_frame)
+    r->on_frame(r->ctx);
+}
+
+// block until a command comes in or ms pass
+static void wait_command(runner_t *r, const uint32_t ms) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += ms / 1000;
+  ts.tv_nsec += (ms % 1000) * 1000000l;
+  if (ts.tv_nsec >= 1000000000l) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000l;
+  }
+  sem_timedwait(&r->wake, &ts);
+}
+
+// forget wakeups for commands already drained. a command sent after this
+// is either seen by pending_commands() or wakes the next wait
+static bool idle_commands(runner_t *r) {
+  while (sem_trywait(&r->wake) == 0)
+    ;
+  return !pending_commands(r);
+}
+
+// the emulation thread: the old single threaded main loop minus SDL
+static void *emulate(void *arg) {
+  runner_t *r = arg;
+  chip8_t *c8 = r->c8;
+  scheduler_t *s = r->sched;
+  uint64_t polled = now_ns(); // the last frame covers input up to here
+  uint64_t t = polled;        // profiler clock, only read when profiling
+  while (c8->state != QUIT && c8->state != LOADING) {
+    const uint64_t since = polled;
+    polled = now_ns();
+    drain_commands(r);
+    atomic_store_explicit(&r->state, c8->state, memory_order_relaxed);
+    if (c8->state == QUIT)
+      break;
+    if (c8->state == PAUSED) {
+      key_flush(&r->keys, c8);
+      r->unpaced = true;
+      if (idle_commands(r))
+        wait_command(r, IDLE_WAIT_MS); // nothing runs until resumed
+      scheduler_resync(s);
+      continue;
+    }
+    if (c8->state == REWINDING) {
+      // a frame back per frame held, the recording forgets it too
+      if (r->rw && rewind_step(r->rw, c8, s) && r->rp)
+        replay_drop(r->rp, 1);
+      key_flush(&r->keys, c8);
+      publish(r);
+      scheduler_wait(s);
+      continue;
+    }
+    if (r->rp) {
+      key_flush(&r->keys, c8);  // recordings hold keys per frame
+      if (!replay_capture(r->rp, c8)) // keys this frame sees
+        break;
+    }
+    // emulation, ips / 60. keys land where they happened since the last poll
+    run_frame_keys(&r->keys, s, c8, r->config, since, polled);
+    if (!s->in_frame) {
+      if (r->rw)
+        rewind_record(r->rw, c8, s);
+      if (r->audio)
+        audio_frame(r->audio, s->beep, c8); // never waits on the device
+      if (r->cap)
+        capture_frame(r->cap, c8); // waits only with --capture-block
+    }
+    if (scheduler_present(s))
+      publish(r);
+    profile_time(c8->prof, PROF_EMULATION, &t);
+    if (scheduler_asleep(s, c8) && idle_commands(r)) {
+      // the rom waits on a key, block until one comes in instead of
+      // ticking through frames that change nothing
+      r->unpaced = true;
+      wait_command(r, IDLE_WAIT_MS);
+      scheduler_resync(s);
+    } else {
+      scheduler_wait(s); // framerate (60Hz), drift corrected
+    }
+    profile_time(c8->prof, PROF_WAIT, &t);
+  }
+  c8->state = QUIT;
+  atomic_store_explicit(&r->state, QUIT, memory_order_relaxed);
+  if (r->on_frame)
+    r->on_frame(r->ctx); // let the frontend see it
+  return NULL;
+}
+
+// rw, rp, audio, cap, on_frame and ctx are taken from *r as the caller set
+// them. c8 and s belong to the emulation thread until stop_runner()
+bool start_runner(runner_t *r, chip8_t *c8, scheduler_t *s,
+                  const config_t config) {
+  r->c8 = c8;
+  r->sched = s;
+  r->config = config;
+  r->back = 0;
+  r->front = 1;
+  atomic_init(&r->middle, 2);
+  atomic_init(&r->cmd_head, 0);
+  atomic_init(&r->cmd_tail, 0);
+  atomic_init(&r->state, c8->state);
+  if (sem_init(&r->wake, 0, 0) != 0) {
+    fprintf(stderr, "Failed to create the wake semaphore!\n");
+    return false;
+  }
+  if (pthread_create(&r->thread, NULL, emulate, r) != 0) {
+    fprintf(stderr, "Failed to start the emulation thread!\n");
+    sem_destroy(&r->wake);
+    return false;
+  }
+  return true;
+}
+
+// quit and wait for the emulation thread, c8 is the caller's again
+void stop_runner(runner_t *r) {
+  runner_command(r, (command_t){.kind = CMD_QUIT});
+  pthread_join(r->thread, NULL);
+  sem_destroy(&r->wake);
+}
+
+emulator_state_t runner_state(runner_t *r) {
+  return atomic_load_explicit(&r->state, memory_order_relaxed);
+}
+
+// frontend side: the newest frame if one came in since the last call,
+// else NULL. the slot stays valid until the next call
+const frame_t *runner_frame(runner_t *r) {
+  // the writer may take a fresh frame back to draw over, so only swap
+  // while the middle is still the fresh one that was seen
+  uint32_t middle = atomic_load_explicit(&r->middle, memory_order_acquire);
+  do {
+    if (!(middle & FRAME_FRESH))
+      return NULL;
+  } while (!atomic_compare_exchange_weak_explicit(
+      &r->middle, &middle, r->front, memory_order_acq_rel,
+      memory_order_acquire));
+  r->front = middle & 3;
+  const frame_t *f = &r->frames[r->front];
+
+  const uint64_t now = now_ns();
+  const uint64_t frame_ns = 1000000000ull / TIMER_HZ;
+  if (r->shown) {
+    r->dropped += f->seq - r->last_seq - 1;
+    // wall clock frames this one was late for showed the last one again
+    const uint64_t slots = (now - r->last_ns + frame_ns / 2) / frame_ns;
+    if (f->paced && slots > 1)
+      r->duplicated += slots - 1;
+  }
+  r->shown++;
+  r->last_seq = f->seq;
+  r->last_ns = now;
+  return f;
+}
+
+void print_frame_stats(const runner_t *r) {
+  if (r->shown == 0)
+    return;
+  printf("frames: %llu shown, %llu dropped, %llu duplicated",
+         (unsigned long long)r->shown, (unsigned long long)r->dropped,
+         (unsigned long long)r->duplicated);
+  if (r->lost)
+    printf(", %llu commands lost", (unsigned long long)r->lost);
+  printf("\n");
+}
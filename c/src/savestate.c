@@ -0,0 +1,147 @@
+#include "../include/savestate.h"
+#include "../include/hash.h"
+#include "../include/le.h"
+#include <stdio.h>
+#include <string.h>
+
+// serialize c8 into buf, returns the bytes written or 0 if cap is short
+size_t save_state(const chip8_t *c8, uint8_t *buf, size_t cap) {
+  if (cap < STATE_SIZE)
+    return 0;
+
+  uint8_t *p = buf;
+  memcpy(p, STATE_MAGIC, 4);
+  p = put_le(p + 4, STATE_VERSION, 2);
+  p = put_le(p, STATE_SIZE, 4);
+  p = put_le(p, c8->rom_hash, 8);
+  memcpy(p, c8->ram, sizeof c8->ram);
+  p += sizeof c8->ram;
+  for (int plane = 0; plane < 2; plane++) {
+    for (int y = 0; y < 64; y++) {
+      p = put_le(p, c8->display[plane][y] >> 64, 8);
+      p = put_le(p, c8->display[plane][y], 8);
+    }
+  }
+  for (int i = 0; i < STACK_SIZE; i++)
+    p = put_le(p, c8->stack[i], 2);
+  memcpy(p, c8->V, sizeof c8->V);
+  p += sizeof c8->V;
+  memcpy(p, c8->flags, sizeof c8->flags);
+  p += sizeof c8->flags;
+  memcpy(p, c8->pattern, sizeof c8->pattern);
+  p += sizeof c8->pattern;
+  p = put_le(p, c8->I, 2);
+  p = put_le(p, c8->PC, 2);
+  p = put_le(p, c8->SP - c8->stack, 1); // pointer saved as depth
+  p = put_le(p, c8->delay_timer, 1);
+  p = put_le(p, c8->sound_timer, 1);
+  p = put_le(p, c8->wait_key, 1);
+  p = put_le(p, c8->hires | c8->planes << 1 | c8->xo_audio << 3, 1);
+  p = put_le(p, c8->pitch, 1);
+  p = put_le(p, c8->rng, 4);
+  p = put_le(p, fnv1a_words(FNV_OFFSET, buf, p - buf), 8);
+  return p - buf;
+}
+
+// restore c8 from buf. nothing is touched unless the state is intact and
+// was saved from the rom c8 has loaded
+bool load_state(chip8_t *c8, const uint8_t *buf, size_t len) {
+  const uint8_t *p = buf;
+  if (len < STATE_SIZE || memcmp(p, STATE_MAGIC, 4) != 0) {
+    fprintf(stderr, "Not a save state.\n");
+    return false;
+  }
+  p += 4;
+  const uint16_t version = get_le(&p, 2);
+  if (version != STATE_VERSION || get_le(&p, 4) != STATE_SIZE) {
+    fprintf(stderr, "Save state version %u is not supported.\n", version);
+    return false;
+  }
+  const uint8_t *end = buf + STATE_SIZE - 8;
+  const uint8_t *sum = end;
+  if (get_le(&sum, 8) != fnv1a_words(FNV_OFFSET, buf, end - buf)) {
+    fprintf(stderr, "Save state checksum mismatch.\n");
+    return false;
+  }
+  if (get_le(&p, 8) != c8->rom_hash) {
+    fprintf(stderr, "Save state is for a different rom.\n");
+    return false;
+  }
+  const uint8_t depth = end[-10]; // before timers, key, mode, pitch, rng
+  if (depth > STACK_SIZE) {
+    fprintf(stderr, "Save state has a bad stack depth.\n");
+    return false;
+  }
+  const uint8_t wait_key = end[-7]; // 0xFF or the key FX0A saw go down
+  if (wait_key != 0xFF && wait_key >= 16) {
+    fprintf(stderr, "Save state has a bad FX0A key.\n");
+    return false;
+  }
+
+  memcpy(c8->ram, p, sizeof c8->ram);
+  p += sizeof c8->ram;
+  for (int plane = 0; plane < 2; plane++) {
+    for (int y = 0; y < 64; y++) {
+      const row_t left = get_le(&p, 8);
+      c8->display[plane][y] = left << 64 | get_le(&p, 8);
+    }
+  }
+  for (int i = 0; i < STACK_SIZE; i++)
+    c8->stack[i] = get_le(&p, 2);
+  memcpy(c8->V, p, sizeof c8->V);
+  p += sizeof c8->V;
+  memcpy(c8->flags, p, sizeof c8->flags);
+  p += sizeof c8->flags;
+  memcpy(c8->pattern, p, sizeof c8->pattern);
+  p += sizeof c8->pattern;
+  c8->I = get_le(&p, 2);
+  c8->PC = get_le(&p, 2);
+  c8->SP = c8->stack + get_le(&p, 1);
+  c8->delay_timer = get_le(&p, 1);
+  c8->sound_timer = get_le(&p, 1);
+  c8->wait_key = get_le(&p, 1);
+  const uint8_t mode = get_le(&p, 1);
+  c8->hires = mode & 1;
+  c8->planes = mode >> 1 & 3;
+  c8->xo_audio = mode >> 3 & 1;
+  c8->pitch = get_le(&p, 1);
+  c8->rng = get_le(&p, 4);
+  c8->dirty_rows = ~0ull;  // redraw everything
+  c8->dirty_pages = ~0ull; // every cached decode is stale
+  return true;
+}
+
+bool save_state_file(const chip8_t *c8, const char *path) {
+  uint8_t buf[STATE_SIZE];
+  const size_t len = save_state(c8, buf, sizeof buf);
+  FILE *f = fopen(path, "wb");
+  if (!f) {
+    fprintf(stderr, "Failed to open %s for writing.\n", path);
+    return false;
+  }
+  const bool ok = fwrite(buf, len, 1, f) == 1;
+  if (fclose(f) != 0 || !ok) {
+    fprintf(stderr, "Could not write save state %s.\n", path);
+    return false;
+  }
+  return true;
+}
+
+bool load_state_file(chip8_t *c8, const char *path) {
+  uint8_t buf[STATE_SIZE];
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "Failed to open %s.\n", path);
+    return false;
+  }
+  const size_t len = fread(buf, 1, sizeof buf, f);
+  fclose(f);
+  return load_state(c8, buf, len);
+}
+
+// identifies a whole machine state, replays and regression runs print it
+uint64_t state_hash(const chip8_t *c8) {
+  uint8_t buf[STATE_SIZE];
+  const size_t len = save_state(c8, buf, sizeof buf);
+  return fnv1a_words(FNV_OFFSET, buf, len - 8); // checksum adds nothing
+}
@@ -0,0 +1,191 @@
+#include "../include/scheduler.h"
+#include "../include/emulator.h"
+#include "../include/engine.h"
+#include "../include/profile.h"
+#include "../include/trace.h"
+#include <time.h>
+
+#define MAX_LAG 4  // frames behind before giving up and resyncing
+#define MAX_SKIP 4 // presents skipped in a row before forcing one
+
+// monotonic clock in ns
+uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+bool init_scheduler(scheduler_t *s, const config_t config) {
+  *s = (scheduler_t){
+      .ips = config.ips,
+      .fast_forward = config.fast_forward,
+      .frame_ns = 1000000000ull / TIMER_HZ,
+      .idle = config.idle,
+  };
+  if (!init_engine(&s->engine, config.engine, config.quirks))
+    return false;
+  s->next_frame = now_ns() + s->frame_ns;
+  return true;
+}
+
+void free_scheduler(scheduler_t *s) { free_engine(&s->engine); }
+
+// length of the busy-wait loop PC is in, 0 if none. *idle is set when a
+// lap would change nothing but PC, keys and timers stay put inside a
+// run_frame() call so the loop then spins until the frame ends:
+//   1NNN to itself
+//   FX0A waiting for a press with no key down, or for a held key to go up
+//   FX07, 3XNN/4XNN, 1NNN back to the FX07 while the delay timer says wait,
+//   once VX holds the timer
+static uint32_t idle_loop(const chip8_t *c8, bool *idle) {
+  *idle = false;
+  const uint16_t pc = c8->PC;
+  if (pc > sizeof c8->ram - 2)
+    return 0;
+  const uint16_t op = c8->ram[pc] << 8 | c8->ram[pc + 1];
+  if (op == (0x1000 | pc)) {
+    *idle = true;
+    return 1;
+  }
+  if ((op & 0xF0FF) == 0xF00A) {
+    *idle = c8->wait_key == 0xFF || c8->keys[c8->wait_key];
+    for (uint8_t k = 0; c8->wait_key == 0xFF && k < sizeof c8->keys; k++)
+      if (c8->keys[k])
+        *idle = false;
+    return 1;
+  }
+  // PC can be anywhere in the timer loop, the engines stop mid-loop
+  const int back = (op & 0xF0FF) == 0xF007              ? 0
+                   : op >> 12 == 0x3 || op >> 12 == 0x4 ? 2
+                   : op >> 12 == 0x1                    ? 4
+                                                        : -1;
+  const int head = pc - back;
+  if (back < 0 || head < 0 || head > (int)sizeof c8->ram - 6)
+    return 0;
+  const uint8_t *m = &c8->ram[head];
+  const uint16_t get = m[0] << 8 | m[1];
+  const uint16_t skip = m[2] << 8 | m[3];
+  const uint16_t jump = m[4] << 8 | m[5];
+  const uint8_t x = (get >> 8) & 0xF;
+  if ((get & 0xF0FF) != 0xF007 || ((skip >> 8) & 0xF) != x ||
+      jump != (0x1000 | head) || (skip >> 12 != 0x3 && skip >> 12 != 0x4))
+    return 0;
+  if ((skip >> 12 == 0x3) != (c8->delay_timer != (skip & 0xFF)))
+    return 0; // the timer lets it out this frame
+  *idle = c8->V[x] == c8->delay_timer;
+  return 3;
+}
+
+static uint32_t run(scheduler_t *s, chip8_t *c8, const config_t config,
+                    const uint32_t n) {
+  // tracing needs every instruction, so it runs the reference interpreter
+  return c8->trace  ? trace_run(c8->trace, c8, config, n)
+         : c8->prof ? profile_run(c8->prof, &s->engine, c8, config, n)
+                    : engine_run(&s->engine, c8, config, n);
+}
+
+// run up to max instructions of the current frame. the timers tick once the
+// whole frame's worth (ips / 60, remainder carried) has been executed, so a
+// frame can be split across calls (headless cycle limits) without drifting
+uint32_t run_frame(scheduler_t *s, chip8_t *c8, const config_t config,
+                   uint32_t max) {
+  if (!s->in_frame) {
+    s->budget += s->ips;
+    s->pending = s->budget / TIMER_HZ;
+    s->budget %= TIMER_HZ;
+    s->in_frame = true;
+  }
+
+  const uint32_t n = s->pending < max ? s->pending : max;
+  uint32_t executed = 0;
+  // short slices so a loop entered mid-frame is caught, a lap at a time
+  // inside one until it settles. skipping whole laps leaves the machine
+  // exactly as running them would. the last IDLE_SLICE instructions just
+  // run, slicing them up would cost more than it saves
+  while (s->idle && !c8->trace && executed < n && c8->state == RUNNING) {
+    bool idle;
+    const uint32_t loop = idle_loop(c8, &idle);
+    if (idle) {
+      const uint32_t laps = (n - executed) / loop * loop;
+      executed += laps;
+      s->idled += laps;
+      break;
+    }
+    if (n - executed <= IDLE_SLICE)
+      break;
+    const uint32_t slice = loop ? loop : IDLE_SLICE;
+    const uint32_t ran = run(s, c8, config, slice);
+    executed += ran;
+    if (ran < slice)
+      break; // stopped (quit, pause)
+  }
+  if (executed < n && c8->state == RUNNING)
+    executed += run(s, c8, config, n - executed);
+  s->pending -= executed;
+  s->cycles += executed;
+
+  if (s->pending == 0) {
+    s->beep = c8->sound_timer != 0;
+    update_timers(c8);
+    s->frames++;
+    s->in_frame = false;
+  }
+  return executed;
+}
+
+// should the frame that just ran be drawn? skips when we are already late
+// (drop frames to catch up), fast forward draws once per wall clock frame
+bool scheduler_present(scheduler_t *s) {
+  const uint64_t now = now_ns();
+  if (s->fast_forward) {
+    if (now < s->next_frame)
+      return false;
+    s->next_frame = now + s->frame_ns;
+    return true;
+  }
+  if (now > s->next_frame && s->skipped < MAX_SKIP) {
+    s->skipped++;
+    return false;
+  }
+  s->skipped = 0;
+  return true;
+}
+
+// nothing can change until a key event: the rom is in an idle loop and
+// neither timer is running, so the host may block on input
+bool scheduler_asleep(const scheduler_t *s, const chip8_t *c8) {
+  bool idle = false;
+  if (s->idle && !c8->trace && c8->state == RUNNING && !s->in_frame &&
+      c8->delay_timer == 0 && c8->sound_timer == 0)
+    idle_loop(c8, &idle);
+  return idle;
+}
+
+// start pacing again from now after a host sleep, the frames slept
+// through would not have changed anything
+void scheduler_resync(scheduler_t *s) {
+  s->next_frame = now_ns() + s->frame_ns;
+  s->sleeps++;
+}
+
+// sleep until the end of the current frame. deadlines are absolute so the
+// time spent emulating/rendering is not added on top like a fixed 16ms sleep
+void scheduler_wait(scheduler_t *s) {
+  if (s->fast_forward)
+    return;
+
+  const uint64_t now = now_ns();
+  if (now > s->next_frame + MAX_LAG * s->frame_ns) {
+    // paused, stalled, or just too slow. don't try to catch up forever
+    s->next_frame = now;
+    s->resyncs++;
+  } else if (now < s->next_frame) {
+    const struct timespec ts = {
+        .tv_sec = s->next_frame / 1000000000ull,
+        .tv_nsec = s->next_frame % 1000000000ull,
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+      ; // interrupted, go back to sleep
+  }
+  s->next_frame += s->frame_ns;
+}
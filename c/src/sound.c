@@ -0,0 +1,34 @@
+#include "../include/sound.h"
+
+#define DEVICE_FRAMES "256" // device buffer, ~5ms at 48kHz
+
+// SDL's audio thread asks for more, hand it what the emulator queued
+static void feed(void *userdata, SDL_AudioStream *stream,
+                 const int additional_amount, const int total_amount) {
+  (void)total_amount;
+  audio_t *a = userdata;
+  int16_t buf[512];
+  for (int left = additional_amount / (int)sizeof *buf; left > 0;) {
+    const uint32_t n = left < 512 ? left : 512;
+    audio_pull(a, buf, n);
+    SDL_PutAudioStreamData(stream, buf, n * sizeof *buf);
+    left -= n;
+  }
+}
+
+// open the default device with a small buffer, sound is optional so a
+// failure only logs
+bool init_sound(sdl_t *sdl, audio_t *a) {
+  init_audio(a);
+  SDL_SetHint(SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES, DEVICE_FRAMES);
+  const SDL_AudioSpec spec = {
+      .format = SDL_AUDIO_S16, .channels = 1, .freq = AUDIO_RATE};
+  sdl->audio = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK,
+                                         &spec, feed, a);
+  if (!sdl->audio) {
+    SDL_Log("Failed to open audio, no sound! Error: %s\n", SDL_GetError());
+    return false;
+  }
+  SDL_ResumeAudioStreamDevice(sdl->audio);
+  return true;
+}
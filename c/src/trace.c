@@ -0,0 +1,139 @@
+#include "../include/trace.h"
+#include "../include/emulator.h"
+#include "../include/hash.h"
+#include "../include/le.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const int crash_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+#define CRASH_SIGNALS (int)(sizeof crash_signals / sizeof crash_signals[0])
+
+// the trace a crash flushes, one per process
+static const trace_t *crash_trace;
+
+static bool write_all(const int fd, const uint8_t *p, size_t len) {
+  while (len) {
+    const ssize_t n = write(fd, p, len);
+    if (n <= 0)
+      return false;
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+// no stdio and no malloc, this also runs from the crash handler
+static bool write_trace(const trace_t *tr, const int fd) {
+  const uint32_t count =
+      tr->records < TRACE_RECORDS ? tr->records : TRACE_RECORDS;
+  uint8_t buf[512 * TRACE_RECORD];
+  memcpy(buf, TRACE_MAGIC, 4);
+  uint8_t *p = put_le(buf + 4, TRACE_VERSION, 2);
+  p = put_le(p, 0, 2);
+  p = put_le(p, tr->c8->rom_hash, 8);
+  p = put_le(p, tr->instructions, 8);
+  p = put_le(p, count, 4);
+  memcpy(p, tr->c8->V, 16);
+  p = put_le(p + 16, tr->c8->I, 2);
+  p = put_le(p, tr->c8->PC, 2);
+  uint64_t sum = fnv1a(FNV_OFFSET, buf, p - buf);
+  if (!write_all(fd, buf, p - buf))
+    return false;
+
+  p = buf;
+  for (uint64_t r = tr->records - count; r < tr->records; r++) {
+    const trace_record_t *rec = &tr->ring[r & (TRACE_RECORDS - 1)];
+    p = put_le(p, rec->pc, 2);
+    p = put_le(p, rec->opcode, 2);
+    *p++ = rec->reg;
+    *p++ = rec->old;
+    p = put_le(p, rec->I, 2);
+    if (p == buf + sizeof buf || r + 1 == tr->records) {
+      sum = fnv1a(sum, buf, p - buf);
+      if (!write_all(fd, buf, p - buf))
+        return false;
+      p = buf;
+    }
+  }
+  put_le(buf, sum, 8);
+  return write_all(fd, buf, 8);
+}
+
+// write what led up to the crash, then die of the same signal
+static void crash_handler(const int sig) {
+  const int fd = open(crash_trace->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    write_trace(crash_trace, fd);
+    close(fd);
+  }
+  signal(sig, SIG_DFL);
+  raise(sig);
+}
+
+bool init_trace(trace_t *tr, const chip8_t *c8, const char *path) {
+  *tr = (trace_t){.c8 = c8, .path = path};
+  if (!(tr->ring = malloc(TRACE_RECORDS * sizeof *tr->ring))) {
+    fprintf(stderr, "Failed to allocate trace ring!\n");
+    return false;
+  }
+  crash_trace = tr;
+  for (int s = 0; s < CRASH_SIGNALS; s++)
+    signal(crash_signals[s], crash_handler);
+  return true;
+}
+
+void free_trace(trace_t *tr) {
+  if (crash_trace == tr) {
+    for (int s = 0; s < CRASH_SIGNALS; s++)
+      signal(crash_signals[s], SIG_DFL);
+    crash_trace = NULL;
+  }
+  free(tr->ring);
+  tr->ring = NULL;
+}
+
+static inline void put_record(trace_t *tr, const trace_record_t rec) {
+  tr->ring[tr->records++ & (TRACE_RECORDS - 1)] = rec;
+}
+
+// run up to n instructions through the reference interpreter, one record
+// per instruction plus one per extra register it changed (8XYN flags,
+// FX65). returns how many ran
+uint32_t trace_run(trace_t *tr, chip8_t *c8, const config_t config,
+                   const uint32_t n) {
+  uint32_t i = 0;
+  for (; i < n && c8->state == RUNNING; i++) {
+    uint8_t V[16];
+    memcpy(V, c8->V, sizeof V);
+    trace_record_t rec = {.pc = c8->PC, .I = c8->I, .reg = TRACE_NONE};
+    emulator(c8, config);
+    rec.opcode = c8->instruction.opcode;
+    for (uint8_t r = 0; r < 16; r++) {
+      if (V[r] == c8->V[r])
+        continue;
+      if (!(rec.reg & TRACE_NONE)) {
+        put_record(tr, rec); // the instruction touched more than one
+        rec.reg = TRACE_MORE;
+      }
+      rec.reg = (rec.reg & TRACE_MORE) | r;
+      rec.old = V[r];
+    }
+    put_record(tr, rec);
+  }
+  tr->instructions += i;
+  return i;
+}
+
+bool flush_trace(const trace_t *tr) {
+  const int fd = open(tr->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool ok = fd >= 0 && write_trace(tr, fd);
+  if (fd >= 0 && close(fd) != 0)
+    ok = false;
+  if (!ok)
+    fprintf(stderr, "Could not write trace %s.\n", tr->path);
+  return ok;
+}
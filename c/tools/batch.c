@@ -0,0 +1,217 @@
+// runs a job list of roms on every core, one chip8_t per job
+//
+// job list, one per line ('#' starts a comment):
+//   rom cycles [seed]
+// results (tab separated, in job order):
+//   rom seed cycles frames wall_ms fb_hash status
+// status is ok, failed when the job could not run or write its capture, or
+// the fault that stopped the rom (stack-overflow, stack-underflow)
+// with --capture DIR every job also writes its frames to DIR/NNNNN.ext,
+// NNNNN being its line in the job order. every rom gets its quirks and
+// ips from the catalog like c8 does, --quirks/--ips override them
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/capture.h"
+#include "../include/catalog.h"
+#include "../include/chip8.h"
+#include "../include/config.h"
+#include "../include/engine.h"
+#include "../include/framebuffer.h"
+#include "../include/headless.h"
+#include "../include/pool.h"
+
+typedef struct Job {
+  char *rom;
+  uint64_t cycles;
+  uint32_t seed;
+  // results
+  uint64_t ran;
+  uint64_t frames;
+  uint64_t wall_ns;
+  uint64_t fb_hash;
+  fault_t fault;
+  bool ok;
+} job_t;
+
+typedef struct Batch {
+  job_t *jobs;
+  uint32_t n_jobs;
+  config_t config;
+  catalog_t cat; // loaded once, read by every job
+} batch_t;
+
+static void run_job(void *ctx, const uint32_t i, const uint32_t worker) {
+  (void)worker;
+  batch_t *b = ctx;
+  job_t *job = &b->jobs[i];
+  size_t size = 0;
+  const uint8_t *rom = map_rom(job->rom, &size);
+  if (!rom) {
+    fprintf(stderr, "Failed to open file %s. Please check the path.\n",
+            job->rom);
+    return;
+  }
+  config_t config = b->config;
+  if (config.catalog) {
+    catalog_entry_t e;
+    lookup_rom(&b->cat, rom, size, &e);
+    apply_entry(&config, &e);
+  }
+  chip8_t *c8 = calloc(1, sizeof(chip8_t));
+  scheduler_t sched;
+
+  const bool loaded = c8 && load_c8(c8, job->rom, rom, size);
+  unmap_rom(rom, size);
+  if (!loaded || !init_scheduler(&sched, config)) {
+    free(c8);
+    return;
+  }
+  seed_c8(c8, job->seed);
+  capture_t cap;
+  char path[4096];
+  if (config.capture) {
+    snprintf(path, sizeof path, "%s/%05u.%s", config.capture, i,
+             capture_extension(config.capture_format));
+    if (!start_capture(&cap, path, config)) {
+      free_scheduler(&sched);
+      free(c8);
+      return;
+    }
+  }
+
+  const uint64_t start = now_ns();
+  job->ran = run_for(&sched, c8, config, job->cycles, NULL,
+                     config.capture ? &cap : NULL);
+  job->wall_ns = now_ns() - start;
+  job->frames = sched.frames;
+  job->fb_hash = display_hash(c8);
+  job->fault = c8->fault;
+  job->ok = !config.capture || stop_capture(&cap);
+
+  free_scheduler(&sched);
+  free(c8);
+}
+
+static bool load_jobs(const char *path, batch_t *b) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "Failed to open job list %s.\n", path);
+    return false;
+  }
+  char line[4096];
+  uint32_t cap = 0;
+  while (fgets(line, sizeof line, f)) {
+    char *hash = strchr(line, '#');
+    if (hash)
+      *hash = '\0';
+    char rom[sizeof line];
+    unsigned long long cycles = 0;
+    unsigned int seed = DEFAULT_SEED;
+    if (sscanf(line, "%4095s %llu %u", rom, &cycles, &seed) < 2)
+      continue; // blank or comment
+
+    if (b->n_jobs == cap) {
+      cap = cap ? cap * 2 : 64;
+      job_t *grown = realloc(b->jobs, cap * sizeof(job_t));
+      if (!grown) {
+        fclose(f);
+        return false;
+      }
+      b->jobs = grown;
+    }
+    b->jobs[b->n_jobs++] = (job_t){
+        .rom = strdup(rom),
+        .cycles = cycles,
+        .seed = seed,
+    };
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr,
+            "Usage: %s [jobs] [--threads N] [--engine E] [--ips N] "
+            "[-o results.tsv] [--capture DIR] [--capture-format F] "
+            "[--capture-drop]\n",
+            argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  batch_t b = {0};
+  uint32_t threads = 0;
+  const char *out_path = NULL;
+  // engine/ips go through the normal option parser, the rest are ours
+  char *opts[argc + 2];
+  int n_opts = 2;
+  opts[0] = argv[0];
+  opts[1] = argv[1];
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+      threads = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+      out_path = argv[++i];
+    else
+      opts[n_opts++] = argv[i];
+  }
+  opts[n_opts++] = "--headless"; // headless defaults, capture blocks
+  if (!set_config_args(&b.config, n_opts, opts))
+    exit(EXIT_FAILURE);
+  if (b.config.capture && strcmp(b.config.capture, "-") == 0) {
+    fprintf(stderr, "--capture takes a directory here, one file per job\n");
+    exit(EXIT_FAILURE);
+  }
+  if (!load_jobs(argv[1], &b))
+    exit(EXIT_FAILURE);
+  // per rom quirks/ips, unless both were given for every job
+  if (b.config.quirks_given && b.config.ips_given)
+    b.config.catalog = NULL;
+  if (b.config.catalog && !load_catalog(&b.cat, b.config.catalog))
+    exit(EXIT_FAILURE);
+
+  FILE *out = out_path ? fopen(out_path, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "Failed to open %s.\n", out_path);
+    exit(EXIT_FAILURE);
+  }
+
+  if (threads == 0)
+    threads = pool_default_threads();
+  if (threads > b.n_jobs) // what pool_run() starts
+    threads = b.n_jobs ? b.n_jobs : 1;
+  const uint64_t start = now_ns();
+  if (!pool_run(b.n_jobs, threads, run_job, &b))
+    exit(EXIT_FAILURE);
+  const double secs = (now_ns() - start) / 1e9;
+
+  uint64_t total = 0;
+  uint32_t failed = 0;
+  fprintf(out, "rom\tseed\tcycles\tframes\twall_ms\tfb_hash\tstatus\n");
+  for (uint32_t i = 0; i < b.n_jobs; i++) {
+    const job_t *job = &b.jobs[i];
+    fprintf(out, "%s\t%u\t%llu\t%llu\t%.3f\t%016llx\t%s\n", job->rom,
+            job->seed, (unsigned long long)job->ran,
+            (unsigned long long)job->frames, job->wall_ns / 1e6,
+            (unsigned long long)job->fb_hash,
+            !job->ok      ? "failed"
+            : job->fault ? fault_name(job->fault)
+                         : "ok");
+    total += job->ran;
+    failed += !job->ok || job->fault;
+    free(job->rom);
+  }
+  fprintf(stderr,
+          "%u jobs (%u failed), %u threads, %s: %llu cycles in %.3fs "
+          "(%.2f MIPS)\n",
+          b.n_jobs, failed, threads, engine_name(b.config.engine),
+          (unsigned long long)total, secs, secs > 0 ? total / secs / 1e6 : 0.0);
+
+  if (out != stdout)
+    fclose(out);
+  free(b.jobs);
+  free_catalog(&b.cat);
+  return failed ? EXIT_FAILURE : 0;
+}
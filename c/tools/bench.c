@@ -0,0 +1,330 @@
+// per opcode family microbenchmarks, the phosphor pass, update_screen()
+// (when built with SDL) and whole rom throughput for every engine, written
+// as JSON
+#define _XOPEN_SOURCE 700
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/chip8.h"
+#include "../include/config.h"
+#include "../include/engine.h"
+#include "../include/headless.h"
+#include "../include/phosphor.h"
+#include "../include/scheduler.h"
+
+#ifdef BENCH_SDL
+#include "../include/display.h"
+#include "../include/init.h"
+#endif
+
+#ifndef BENCH_REV
+#define BENCH_REV "unknown"
+#endif
+
+#define MICRO_OPS 32       // body repeats to this many ops, then loops
+#define MAX_ROMS 1024      // corpus files considered
+#define RENDER_FRAMES 2000 // update_screen()/phosphor frames per case
+
+// a loop of one opcode family: setup runs once, body repeats. both lists
+// end at a 0 entry (0NNN is never needed here)
+typedef struct Micro {
+  const char *name;
+  uint16_t setup[4];
+  uint16_t body[8];
+} micro_t;
+
+static const micro_t micros[] = {
+    {"8xyn", {0x6005, 0x6107},
+     {0x8010, 0x8011, 0x8012, 0x8013, 0x8014, 0x8015, 0x8016, 0x8017}},
+    {"skip", {0x6005, 0x6107}, {0x3005, 0x4005, 0x5010, 0x9010, 0x3105}},
+    {"7xnn", {0}, {0x7001, 0x7102, 0x7203, 0x7304}},
+    {"dxyn_1", {0x6005, 0x6107, 0xA800}, {0xD011}},
+    {"dxyn_4", {0x6005, 0x6107, 0xA800}, {0xD014}},
+    {"dxyn_8", {0x6005, 0x6107, 0xA800}, {0xD018}},
+    {"dxyn_15", {0x6005, 0x6107, 0xA800}, {0xD01F}},
+    {"fx33", {0x60FE, 0xA800}, {0xF033}},
+    {"00e0", {0}, {0x00E0}},
+};
+
+typedef struct Bench {
+  FILE *out;
+  uint64_t micro_ops;
+  uint64_t rom_cycles;
+  bool all_engines;
+  engine_kind_t engine;
+  bool first; // no comma before the next JSON object
+  char *roms[MAX_ROMS];
+  uint32_t n_roms;
+} bench_t;
+
+static bench_t bench;
+
+static void json_string(FILE *out, const char *s) {
+  fputc('"', out);
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', out);
+    fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+static void json_sep(void) {
+  fprintf(bench.out, bench.first ? "\n    " : ",\n    ");
+  bench.first = false;
+}
+
+static size_t build_micro(const micro_t *m, uint8_t *rom) {
+  size_t n = 0;
+  for (int i = 0; i < 4 && m->setup[i]; i++, n += 2) {
+    rom[n] = m->setup[i] >> 8;
+    rom[n + 1] = m->setup[i] & 0xFF;
+  }
+  const uint16_t loop = 0x200 + n;
+  int body = 0;
+  while (body < 8 && m->body[body])
+    body++;
+  for (int i = 0; i < MICRO_OPS; i++, n += 2) {
+    rom[n] = m->body[i % body] >> 8;
+    rom[n + 1] = m->body[i % body] & 0xFF;
+  }
+  rom[n++] = 0x10 | loop >> 8; // 1NNN back to the body
+  rom[n++] = loop & 0xFF;
+  return n;
+}
+
+static void run_micro(const micro_t *m, const engine_kind_t kind,
+                      const config_t config) {
+  uint8_t rom[2 * (4 + MICRO_OPS + 1)];
+  const size_t len = build_micro(m, rom);
+  chip8_t *c8 = calloc(1, sizeof(chip8_t));
+  engine_t e;
+  if (!c8 || !load_c8(c8, (char *)m->name, rom, len) ||
+      !init_engine(&e, kind, config.quirks)) {
+    free(c8);
+    return;
+  }
+
+  engine_run(&e, c8, config, 10000); // warm caches and translations
+  uint64_t ops = 0;
+  const uint64_t start = now_ns();
+  while (ops < bench.micro_ops)
+    ops += engine_run(&e, c8, config, 100000);
+  const double ns = (double)(now_ns() - start);
+
+  json_sep();
+  fprintf(bench.out,
+          "{\"name\": \"%s\", \"engine\": \"%s\", \"ops\": %llu, "
+          "\"ns_per_op\": %.3f, \"mips\": %.2f}",
+          m->name, engine_name(kind), (unsigned long long)ops, ns / ops,
+          ops / ns * 1e3);
+  free_engine(&e);
+  free(c8);
+}
+
+static void run_rom(char *path, const engine_kind_t kind, config_t config) {
+  chip8_t *c8 = calloc(1, sizeof(chip8_t));
+  scheduler_t sched;
+  config.engine = kind;
+  if (!c8 || !init_c8(c8, path) || !init_scheduler(&sched, config)) {
+    free(c8);
+    return;
+  }
+
+  const uint64_t start = now_ns();
+  const uint64_t cycles = run_for(&sched, c8, config, bench.rom_cycles, NULL,
+                                 NULL);
+  const double secs = (now_ns() - start) / 1e9;
+
+  json_sep();
+  fprintf(bench.out, "{\"rom\": ");
+  json_string(bench.out, path);
+  fprintf(bench.out,
+          ", \"engine\": \"%s\", \"cycles\": %llu, \"seconds\": %.6f, "
+          "\"mips\": %.2f}",
+          engine_name(kind), (unsigned long long)cycles, secs,
+          secs > 0 ? cycles / secs / 1e6 : 0.0);
+  free_scheduler(&sched);
+  free(c8);
+}
+
+// the phosphor pass alone into memory, every row changed and a tick gone
+// by each frame, so every pixel is decayed, lit and coloured
+static void run_phosphor(const config_t config) {
+  chip8_t *c8 = calloc(1, sizeof(chip8_t));
+  phosphor_t *ph = malloc(sizeof *ph);
+  uint32_t *pixels = malloc(DISPLAY_WIDTH * DISPLAY_HEIGHT * sizeof *pixels);
+  if (!c8 || !ph || !pixels) {
+    free(c8);
+    free(ph);
+    free(pixels);
+    return;
+  }
+  const char *cases[] = {"lores", "hires"};
+  for (int k = 0; k < 2; k++) {
+    init_phosphor(ph, config);
+    c8->hires = k == 1;
+    const uint32_t height = screen_height(c8);
+    uint64_t now = 1;
+    const uint64_t start = now_ns();
+    for (int f = 0; f < RENDER_FRAMES; f++) {
+      for (uint32_t y = 0; y < height; y++)
+        c8->display[y & 1][y] ^= (row_t)0x5555555555555555ull << (f & 1);
+      c8->dirty_rows = ALL_ROWS;
+      now += 1000000000ull / TIMER_HZ;
+      const uint64_t rows = phosphor_advance(ph, c8, now);
+      for (uint32_t y = 0; y < height; y++)
+        if (rows >> y & 1)
+          phosphor_row(ph, c8, y, pixels + y * DISPLAY_WIDTH);
+    }
+    const double ns = (double)(now_ns() - start);
+    json_sep();
+    fprintf(bench.out, "{\"name\": \"phosphor_%s\", \"ns_per_frame\": "
+                       "%.1f}",
+            cases[k], ns / RENDER_FRAMES);
+  }
+  free(c8);
+  free(ph);
+  free(pixels);
+}
+
+#ifdef BENCH_SDL
+// update_screen() into an offscreen window: every row changed, one row
+// changed and nothing changed since the last present
+static void run_render(const config_t config) {
+  SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+  sdl_t sdl = {0};
+  chip8_t *c8 = calloc(1, sizeof(chip8_t));
+  phosphor_t *ph = malloc(sizeof *ph);
+  if (!c8 || !ph || !init_sdl(&sdl, config)) {
+    free(c8);
+    free(ph);
+    return;
+  }
+  prep_screen(config, sdl);
+  init_phosphor(ph, config);
+
+  const char *cases[] = {"full", "one_row", "clean"};
+  for (int k = 0; k < 3; k++) {
+    const uint64_t start = now_ns();
+    for (int f = 0; f < RENDER_FRAMES; f++) {
+      c8->display[0][f % 32] ^= (row_t)0x5555555555555555ull
+                                << (DISPLAY_WIDTH / 2 + (f & 1));
+      c8->dirty_rows = k == 0 ? ALL_ROWS : k == 1 ? 1ull << (f % 32) : 0;
+      update_screen(sdl, ph, c8);
+    }
+    const double ns = (double)(now_ns() - start);
+    json_sep();
+    fprintf(bench.out, "{\"name\": \"update_screen_%s\", \"ns_per_frame\": "
+                       "%.1f}",
+            cases[k], ns / RENDER_FRAMES);
+  }
+
+  SDL_DestroyTexture(sdl.texture);
+  SDL_DestroyRenderer(sdl.renderer);
+  SDL_DestroyWindow(sdl.window);
+  SDL_Quit();
+  free(c8);
+  free(ph);
+}
+#endif
+
+static int add_rom(const char *path, const struct stat *st, int type,
+                   struct FTW *ftw) {
+  (void)st;
+  (void)ftw;
+  const size_t len = strlen(path);
+  if (type == FTW_F && len > 4 && strcmp(path + len - 4, ".ch8") == 0 &&
+      bench.n_roms < MAX_ROMS)
+    bench.roms[bench.n_roms++] = strdup(path);
+  return 0;
+}
+
+static int by_name(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+int main(int argc, char **argv) {
+  const char *out_path = NULL;
+  const char *dirs[16] = {"fp", "../chip8-roms"};
+  int n_dirs = 2, custom_dirs = 0;
+  bench = (bench_t){
+      .out = stdout,
+      .micro_ops = 20000000,
+      .rom_cycles = 5000000,
+      .all_engines = true,
+      .first = true,
+  };
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+      bench.micro_ops = strtoull(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+      bench.rom_cycles = strtoull(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+      if (!parse_engine(argv[++i], &bench.engine)) {
+        fprintf(stderr, "Unknown engine: %s\n", argv[i]);
+        exit(EXIT_FAILURE);
+      }
+      bench.all_engines = false;
+    } else if (strcmp(argv[i], "--roms") == 0 && i + 1 < argc) {
+      if (!custom_dirs++)
+        n_dirs = 0; // replace the default corpus
+      if (n_dirs < 16)
+        dirs[n_dirs++] = argv[++i];
+    } else {
+      fprintf(stderr,
+              "Usage: %s [-o bench.json] [--ops N] [--cycles N] "
+              "[--engine E] [--roms DIR]...\n",
+              argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  // defaults for everything else: no window, 700 ips, table engine. idle
+  // loops run, skipped laps would count as instructions that never ran
+  char *defaults[] = {argv[0], "bench", "--headless", "--no-idle"};
+  config_t config;
+  if (!set_config_args(&config, 4, defaults))
+    exit(EXIT_FAILURE);
+
+  for (int d = 0; d < n_dirs; d++)
+    nftw(dirs[d], add_rom, 16, FTW_PHYS); // missing dirs are fine
+  qsort(bench.roms, bench.n_roms, sizeof *bench.roms, by_name);
+
+  if (out_path && !(bench.out = fopen(out_path, "w"))) {
+    fprintf(stderr, "Failed to open %s.\n", out_path);
+    exit(EXIT_FAILURE);
+  }
+  const engine_kind_t first = bench.all_engines ? ENGINE_SWITCH : bench.engine;
+  const engine_kind_t last = bench.all_engines ? ENGINE_JIT : bench.engine;
+
+  fprintf(bench.out, "{\n  \"rev\": \"%s\",\n  \"timestamp\": %lld,\n",
+          BENCH_REV, (long long)time(NULL));
+  fprintf(bench.out, "  \"micro\": [");
+  for (size_t m = 0; m < sizeof micros / sizeof *micros; m++)
+    for (engine_kind_t k = first; k <= last; k++)
+      run_micro(&micros[m], k, config);
+  fprintf(bench.out, "\n  ],\n  \"render\": [");
+  bench.first = true;
+  run_phosphor(config);
+#ifdef BENCH_SDL
+  run_render(config);
+#endif
+  fprintf(bench.out, "\n  ],\n  \"roms\": [");
+  bench.first = true;
+  for (uint32_t r = 0; r < bench.n_roms; r++)
+    for (engine_kind_t k = first; k <= last; k++)
+      run_rom(bench.roms[r], k, config);
+  fprintf(bench.out, "\n  ]\n}\n");
+
+  if (bench.out != stdout)
+    fclose(bench.out);
+  for (uint32_t r = 0; r < bench.n_roms; r++)
+    free(bench.roms[r]);
+  return 0;
+}
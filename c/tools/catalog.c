@@ -0,0 +1,72 @@
+// scans rom directories into the catalog index that c8, c8-headless and
+// c8-lockstep read their default quirks and ips from
+//
+// index (tab separated, one rom per line, sorted by path):
+//   hash size mtime platform quirks ips path
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/catalog.h"
+#include "../include/chip8.h"
+#include "../include/pool.h"
+#include "../include/scheduler.h"
+
+int main(int argc, char **argv) {
+  char *dirs[argc + 2];
+  uint32_t n_dirs = 0, threads = 0;
+  const char *out_path = CATALOG_DEFAULT;
+  bool list = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if (strcmp(argv[i], "--list") == 0) {
+      list = true;
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr,
+              "Usage: %s [dirs...] [-o index] [--threads N] [--list]\n",
+              argv[0]);
+      exit(EXIT_FAILURE);
+    } else {
+      dirs[n_dirs++] = argv[i];
+    }
+  }
+  if (n_dirs == 0) {
+    dirs[n_dirs++] = "fp";
+    dirs[n_dirs++] = "../chip8-roms";
+  }
+  if (threads == 0)
+    threads = pool_default_threads();
+
+  catalog_t cat;
+  if (!load_catalog(&cat, out_path))
+    exit(EXIT_FAILURE);
+  const uint32_t before = cat.n;
+  const uint64_t start = now_ns();
+  if (!scan_catalog(&cat, dirs, n_dirs, threads) ||
+      !save_catalog(&cat, out_path))
+    exit(EXIT_FAILURE);
+  const double secs = (now_ns() - start) / 1e9;
+
+  if (list) {
+    for (uint32_t i = 0; i < cat.n; i++) {
+      const catalog_entry_t *e = &cat.entries[i];
+      printf("%016llx  %-6s  %-6s %6u  %s\n", (unsigned long long)e->hash,
+             platform_name(e->platform), quirks_name(e->quirks), e->ips,
+             e->path);
+    }
+  }
+  uint32_t per_platform[PLATFORM_COUNT] = {0};
+  for (uint32_t i = 0; i < cat.n; i++)
+    per_platform[cat.entries[i].platform]++;
+  fprintf(stderr, "%s: %u roms (", out_path, cat.n);
+  for (uint32_t p = 0; p < PLATFORM_COUNT; p++)
+    fprintf(stderr, "%s%u %s", p ? ", " : "", per_platform[p],
+            platform_name(p));
+  fprintf(stderr, "), %u hashed on %u threads, %u kept of %u in %.3fs\n",
+          cat.hashed, threads, cat.n - cat.hashed, before, secs);
+  free_catalog(&cat);
+  return 0;
+}
@@ -0,0 +1,242 @@
+// runs roms through two engines side by side with the same keys and seed
+// and compares the whole machine after every step (an instruction, or a
+// block for the block and jit engines). stops a rom at the first
+// difference and shows what the reference ran and what differs
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/chip8.h"
+#include "../include/config.h"
+#include "../include/debug.h"
+#include "../include/emulator.h"
+#include "../include/engine.h"
+#include "../include/ops.h"
+#include "../include/scheduler.h"
+
+typedef struct Check {
+  engine_kind_t ref;  // trusted engine, switch (emulator()) by default
+  engine_kind_t test; // engine being checked
+  uint64_t cycles;    // per rom
+  uint32_t step;      // instructions the tested engine may run per compare
+  uint32_t per_frame; // instructions between timer ticks
+  uint32_t seed;
+} check_t;
+
+// the key held in a frame, changes every 16 frames
+static void frame_keys(bool keys[16], const uint32_t frame) {
+  uint32_t h = (frame / 16) * 0x85EBCA6Bu;
+  h ^= h >> 15;
+  memset(keys, 0, 16);
+  if (h & 0x10) // no key half the time
+    keys[h & 0xF] = 1;
+}
+
+static void copy_c8(chip8_t *dst, const chip8_t *src) {
+  *dst = *src;
+  dst->SP = dst->stack + (src->SP - src->stack);
+}
+
+// compare everything an instruction can change. prints each difference
+// when out is given, returns true if the machines match
+static bool same_c8(const chip8_t *a, const chip8_t *b, FILE *out,
+                    const char *na, const char *nb) {
+  bool same = true;
+#define DIFF(label, fmt, va, vb)                                               \
+  do {                                                                         \
+    if ((va) != (vb)) {                                                        \
+      same = false;                                                            \
+      if (out)                                                                 \
+        fprintf(out, "  %-12s %s " fmt "  %s " fmt "\n", label, na,          \
+                (unsigned long long)(va), nb, (unsigned long long)(vb));       \
+    }                                                                          \
+  } while (0)
+
+  char label[32];
+  DIFF("state", "%llu", a->state, b->state);
+  DIFF("fault", "%llu", a->fault, b->fault);
+  DIFF("PC", "0x%03llX", a->PC, b->PC);
+  DIFF("I", "0x%03llX", a->I, b->I);
+  DIFF("SP", "%llu", a->SP - a->stack, b->SP - b->stack);
+  DIFF("delay_timer", "%llu", a->delay_timer, b->delay_timer);
+  DIFF("sound_timer", "%llu", a->sound_timer, b->sound_timer);
+  DIFF("wait_key", "0x%02llX", a->wait_key, b->wait_key);
+  DIFF("rng", "0x%08llX", a->rng, b->rng);
+  DIFF("hires", "%llu", a->hires, b->hires);
+  DIFF("planes", "%llu", a->planes, b->planes);
+  DIFF("pitch", "%llu", a->pitch, b->pitch);
+  DIFF("xo_audio", "%llu", a->xo_audio, b->xo_audio);
+  for (int i = 0; i < 16; i++) {
+    snprintf(label, sizeof label, "V%X", i);
+    DIFF(label, "0x%02llX", a->V[i], b->V[i]);
+  }
+  for (int i = 0; i < 16; i++) {
+    snprintf(label, sizeof label, "flags[%d]", i);
+    DIFF(label, "0x%02llX", a->flags[i], b->flags[i]);
+    snprintf(label, sizeof label, "pattern[%d]", i);
+    DIFF(label, "0x%02llX", a->pattern[i], b->pattern[i]);
+  }
+  for (int i = 0; i < STACK_SIZE; i++) {
+    snprintf(label, sizeof label, "stack[%d]", i);
+    DIFF(label, "0x%03llX", a->stack[i], b->stack[i]);
+  }
+  int shown = 0;
+  if (memcmp(a->ram, b->ram, sizeof a->ram) != 0) {
+    for (size_t i = 0; i < sizeof a->ram; i++) {
+      if (a->ram[i] != b->ram[i] && (!out || shown++ < 16)) {
+        snprintf(label, sizeof label, "ram[0x%04zX]", i);
+        DIFF(label, "0x%02llX", a->ram[i], b->ram[i]);
+      }
+    }
+  }
+  for (int p = 0; p < 2; p++) {
+    for (int y = 0; y < DISPLAY_HEIGHT; y++) {
+      snprintf(label, sizeof label, "plane %d row %d", p, y);
+      DIFF(label, "%016llX", a->display[p][y] >> 64, b->display[p][y] >> 64);
+      DIFF(label, "%016llX", (uint64_t)a->display[p][y],
+           (uint64_t)b->display[p][y]);
+    }
+  }
+#undef DIFF
+  return same;
+}
+
+// re-run the window that diverged on the reference, one line per op
+static void report(const check_t *ck, const chip8_t *before, const chip8_t *a,
+                   const chip8_t *b, const uint64_t at, const uint32_t n,
+                   const config_t config) {
+  printf("%s: %s differs from %s after cycles %llu-%llu\n", a->rom_name,
+         engine_name(ck->test), engine_name(ck->ref), (unsigned long long)at,
+         (unsigned long long)(at + n));
+  printf("%s ran:\n", engine_name(ck->ref));
+
+  chip8_t *c8 = malloc(sizeof(chip8_t));
+  engine_t e;
+  if (c8 && init_engine(&e, ck->ref, config.quirks)) {
+    copy_c8(c8, before);
+    for (uint32_t i = 0; i < n; i++) {
+      const uint16_t op = fetch(c8, c8->PC);
+      printf("  ");
+      print_op(stdout, c8, c8->PC, decode_instruction(op));
+      engine_run(&e, c8, config, 1);
+    }
+    free_engine(&e);
+  }
+  free(c8);
+  printf("differences:\n");
+  same_c8(a, b, stdout, engine_name(ck->ref), engine_name(ck->test));
+}
+
+static bool check_rom(const check_t *ck, char *rom, const config_t config) {
+  chip8_t *a = calloc(1, sizeof(chip8_t));
+  chip8_t *b = calloc(1, sizeof(chip8_t));
+  chip8_t *before = malloc(sizeof(chip8_t));
+  engine_t ea = {0}, eb = {0};
+  bool ok = a && b && before && init_c8(a, rom) &&
+            init_engine(&ea, ck->ref, config.quirks) &&
+            init_engine(&eb, ck->test, config.quirks);
+  if (ok) {
+    seed_c8(a, ck->seed);
+    copy_c8(b, a);
+  }
+
+  uint64_t cycles = 0;
+  bool running = ok;
+  for (uint32_t frame = 0; ok && running && cycles < ck->cycles; frame++) {
+    frame_keys(a->keys, frame);
+    frame_keys(b->keys, frame);
+    for (uint32_t left = ck->per_frame; ok && running && left > 0;) {
+      const uint32_t n = left < ck->step ? left : ck->step;
+      copy_c8(before, a);
+      const uint32_t ran = engine_run(&eb, b, config, n);
+      const uint32_t ref = engine_run(&ea, a, config, ran);
+      if (ref != ran || !same_c8(a, b, NULL, NULL, NULL)) {
+        report(ck, before, a, b, cycles, ran, config);
+        ok = false;
+      }
+      cycles += ran;
+      left -= ran;
+      // 00FD or a stack fault, both stopped at the same place
+      running = ran > 0 && b->state == RUNNING;
+    }
+    update_timers(a);
+    update_timers(b);
+  }
+  if (ok)
+    printf("%s: %s matches %s for %llu cycles%s\n", rom,
+           engine_name(ck->test), engine_name(ck->ref),
+           (unsigned long long)cycles, running ? "" : " until the rom quit");
+
+  free_engine(&ea);
+  free_engine(&eb);
+  free(before);
+  free(b);
+  free(a);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  check_t ck = {
+      .ref = ENGINE_SWITCH,
+      .cycles = 1000000,
+      .step = 64,
+      .seed = DEFAULT_SEED,
+  };
+  bool all = true;
+  quirk_profile_t quirks = QUIRKS_CHIP8;
+  char *ips = "700"; // a step never crosses a frame, raise it for long blocks
+  int first_rom = argc;
+  for (int i = 1; i < argc && first_rom == argc; i++) {
+    if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+      all = false;
+      if (!parse_engine(argv[++i], &ck.test))
+        first_rom = -1;
+    } else if (strcmp(argv[i], "--against") == 0 && i + 1 < argc) {
+      if (!parse_engine(argv[++i], &ck.ref))
+        first_rom = -1;
+    } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+      ck.cycles = strtoull(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+      ck.step = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--ips") == 0 && i + 1 < argc) {
+      ips = argv[++i];
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      ck.seed = strtoul(argv[++i], NULL, 0);
+    } else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+      if (!parse_quirks(argv[++i], &quirks))
+        first_rom = -1;
+    } else if (argv[i][0] == '-') {
+      first_rom = -1;
+    } else {
+      first_rom = i;
+    }
+  }
+  if (first_rom < 0 || first_rom >= argc || ck.step == 0) {
+    fprintf(stderr,
+            "Usage: %s [--engine E] [--against E] [--cycles N] [--step N] "
+            "[--ips N] [--seed N] [--quirks P] roms...\n",
+            argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  char *defaults[] = {argv[0], "check", "--headless", "--ips", ips};
+  config_t config;
+  if (!set_config_args(&config, 5, defaults))
+    exit(EXIT_FAILURE);
+  config.quirks = quirks;
+  ck.per_frame = config.ips / TIMER_HZ;
+
+  uint32_t roms = 0, failed = 0;
+  for (int r = first_rom; r < argc; r++) {
+    for (engine_kind_t k = ENGINE_SWITCH; k <= ENGINE_JIT; k++) {
+      if ((all && k == ck.ref) || (!all && k != ck.test))
+        continue;
+      check_t run = ck;
+      run.test = k;
+      roms++;
+      failed += !check_rom(&run, argv[r], config);
+    }
+  }
+  printf("%u checks, %u failed\n", roms, failed);
+  return failed ? EXIT_FAILURE : 0;
+}
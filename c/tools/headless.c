@@ -0,0 +1,38 @@
+// SDL-free runner for build hosts, same as `c8 rom --headless`
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/catalog.h"
+#include "../include/chip8.h"
+#include "../include/config.h"
+#include "../include/headless.h"
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr,
+            "Usage: %s [rom] [--cycles N] [--ips N] "
+            "[--engine switch|table|block|jit] [--rewind SECONDS] [--seed N] "
+            "[--replay FILE] [--profile PREFIX] [--trace FILE] [--no-idle] "
+            "[--quirks P] [--catalog FILE] [--no-catalog] [--capture FILE] "
+            "[--capture-format raw|y4m|apng] [--capture-drop]\n",
+            argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  // parse as `c8 rom ... --headless` so headless defaults apply
+  char *opts[argc + 1];
+  memcpy(opts, argv, argc * sizeof *argv);
+  opts[argc] = "--headless";
+  config_t config = {0};
+  if (!set_config_args(&config, argc + 1, opts))
+    exit(EXIT_FAILURE);
+  apply_catalog(&config, argv[1]);
+  chip8_t c8 = {0};
+  if (!init_c8(&c8, argv[1]))
+    exit(EXIT_FAILURE);
+  seed_c8(&c8, config.seed);
+
+  if (!run_headless(&c8, config))
+    exit(EXIT_FAILURE);
+  return 0;
+}
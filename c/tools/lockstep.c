@@ -0,0 +1,132 @@
+// steps many copies of one rom with different inputs, once as separate
+// chip8_t instances through the chosen engine and once through the
+// lockstep engine, then checks every lane ended in the same state
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/catalog.h"
+#include "../include/chip8.h"
+#include "../include/config.h"
+#include "../include/emulator.h"
+#include "../include/engine.h"
+#include "../include/framebuffer.h"
+#include "../include/lockstep.h"
+#include "../include/scheduler.h"
+
+// the key lane l holds down in a frame, changes every 16 frames
+static void lane_keys(bool keys[16], const uint32_t lane,
+                      const uint32_t frame) {
+  uint32_t h = (lane + 1) * 0x9E3779B9u ^ (frame / 16) * 0x85EBCA6Bu;
+  h ^= h >> 15;
+  memset(keys, 0, 16);
+  if (h & 0x10) // no key half the time
+    keys[h & 0xF] = 1;
+}
+
+static uint64_t lane_hash(const chip8_t *c8) {
+  uint64_t h = display_hash(c8);
+  h = fnv1a(h, c8->V, sizeof c8->V);
+  h = fnv1a(h, &c8->I, sizeof c8->I);
+  h = fnv1a(h, &c8->PC, sizeof c8->PC);
+  h = fnv1a(h, &c8->delay_timer, 2);
+  h = fnv1a(h, &c8->state, sizeof c8->state);
+  return fnv1a(h, c8->ram, sizeof c8->ram);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr,
+            "Usage: %s [rom] [--lanes N] [--frames N] [--engine E] "
+            "[--ips N] [--quirks P]\n",
+            argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  uint32_t lanes = 256, frames = 600;
+  config_t config;
+  char *opts[argc + 1];
+  int n_opts = 2;
+  opts[0] = argv[0];
+  opts[1] = argv[1];
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--lanes") == 0 && i + 1 < argc)
+      lanes = strtoul(argv[++i], NULL, 0);
+    else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+      frames = strtoul(argv[++i], NULL, 0);
+    else
+      opts[n_opts++] = argv[i];
+  }
+  if (!set_config_args(&config, n_opts, opts) || lanes == 0)
+    exit(EXIT_FAILURE);
+  apply_catalog(&config, argv[1]);
+  const uint32_t per_frame = config.ips / TIMER_HZ;
+
+  chip8_t *proto = calloc(1, sizeof(chip8_t));
+  chip8_t *scalar = calloc(lanes, sizeof(chip8_t));
+  engine_t *engines = calloc(lanes, sizeof(engine_t));
+  lockstep_t ls;
+  if (!proto || !scalar || !engines || !init_c8(proto, argv[1]) ||
+      !init_lockstep(&ls, proto, lanes))
+    exit(EXIT_FAILURE);
+
+  for (uint32_t l = 0; l < lanes; l++) {
+    scalar[l] = *proto;
+    scalar[l].SP = scalar[l].stack;
+    seed_c8(&scalar[l], l + 1);
+    seed_c8(&ls.c8[l], l + 1);
+    if (!init_engine(&engines[l], config.engine, config.quirks))
+      exit(EXIT_FAILURE);
+  }
+
+  // N scalar instances, frame by frame so both runs see the same input.
+  // lanes that quit stop counting
+  uint64_t total = 0;
+  uint64_t start = now_ns();
+  for (uint32_t f = 0; f < frames; f++) {
+    for (uint32_t l = 0; l < lanes; l++) {
+      lane_keys(scalar[l].keys, l, f);
+      total += engine_run(&engines[l], &scalar[l], config, per_frame);
+      update_timers(&scalar[l]);
+    }
+  }
+  const double scalar_s = (now_ns() - start) / 1e9;
+
+  start = now_ns();
+  for (uint32_t f = 0; f < frames; f++) {
+    for (uint32_t l = 0; l < lanes; l++)
+      lane_keys(ls.c8[l].keys, l, f);
+    for (uint32_t i = 0; i < per_frame; i++)
+      lockstep_step(&ls, config);
+    lockstep_end_frame(&ls);
+  }
+  const double lockstep_s = (now_ns() - start) / 1e9;
+
+  uint32_t match = 0;
+  for (uint32_t l = 0; l < lanes; l++) {
+    if (lane_hash(&scalar[l]) == lane_hash(lockstep_lane(&ls, l)))
+      match++;
+    else if (lanes - match < 8)
+      fprintf(stderr, "lane %u: PC %03X vs %03X\n", l, scalar[l].PC,
+              ls.c8[l].PC);
+  }
+
+  const uint64_t done = ls.vector_ops + ls.scalar_ops;
+  printf("%s: %u lanes, %u frames, %llu instructions\n", argv[1], lanes,
+         frames, (unsigned long long)total);
+  printf("scalar (%s): %.3fs, %.2f MIPS\n", engine_name(config.engine),
+         scalar_s, total / scalar_s / 1e6);
+  printf("lockstep: %.3fs, %.2f MIPS (%.1f%% vector, %.1f lanes/group)\n",
+         lockstep_s, total / lockstep_s / 1e6,
+         done ? 100.0 * ls.vector_ops / done : 0.0,
+         ls.groups ? (double)ls.vector_ops / ls.groups : 0.0);
+  printf("lanes matching: %u/%u\n", match, lanes);
+
+  for (uint32_t l = 0; l < lanes; l++)
+    free_engine(&engines[l]);
+  free_lockstep(&ls);
+  free(engines);
+  free(scalar);
+  free(proto);
+  return match == lanes ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+// turns a --trace file back into the descriptions print_op() gives, plus
+// the registers and I each instruction changed. the registers before every
+// instruction are rebuilt by walking back from the values the file ends with
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/debug.h"
+#include "../include/hash.h"
+#include "../include/le.h"
+#include "../include/trace.h"
+
+// registers before an instruction
+typedef struct Regs {
+  uint8_t V[16];
+  uint16_t I;
+} regs_t;
+
+static uint8_t *read_file(const char *path, long *size) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "Failed to open %s.\n", path);
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  *size = ftell(f);
+  rewind(f);
+  uint8_t *buf = *size > 0 ? malloc(*size) : NULL;
+  const bool read = buf && fread(buf, *size, 1, f) == 1;
+  fclose(f);
+  if (!read) {
+    fprintf(stderr, "Could not read %s.\n", path);
+    free(buf);
+    return NULL;
+  }
+  return buf;
+}
+
+static void print_changes(const regs_t *before, const regs_t *after) {
+  bool any = false;
+  for (int r = 0; r < 16; r++) {
+    if (before->V[r] == after->V[r])
+      continue;
+    printf("%s V%X %02X -> %02X", any ? "," : "    ", r, before->V[r],
+           after->V[r]);
+    any = true;
+  }
+  if (before->I != after->I) {
+    printf("%s I %03X -> %03X", any ? "," : "    ", before->I, after->I);
+    any = true;
+  }
+  if (any)
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s [trace] [--last N]\n", argv[0]);
+    exit(EXIT_FAILURE);
+  }
+  uint64_t last = UINT64_MAX;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "--last") == 0 && i + 1 < argc) {
+      last = strtoull(argv[++i], NULL, 0);
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  long size = 0;
+  uint8_t *buf = read_file(argv[1], &size);
+  if (!buf)
+    exit(EXIT_FAILURE);
+  if (size < TRACE_HEADER + 8 || memcmp(buf, TRACE_MAGIC, 4) != 0) {
+    fprintf(stderr, "%s is not a trace.\n", argv[1]);
+    exit(EXIT_FAILURE);
+  }
+  const uint8_t *p = buf + 4;
+  const uint8_t *sum = buf + size - 8;
+  const uint16_t version = get_le(&p, 2);
+  get_le(&p, 2); // flags
+  const uint64_t rom_hash = get_le(&p, 8);
+  const uint64_t instructions = get_le(&p, 8);
+  const uint32_t count = get_le(&p, 4);
+  regs_t regs;
+  memcpy(regs.V, p, 16);
+  p += 16;
+  regs.I = get_le(&p, 2);
+  const uint16_t final_pc = get_le(&p, 2);
+
+  const char *err = NULL;
+  if (version != TRACE_VERSION)
+    err = "unsupported version";
+  else if ((size_t)size != TRACE_HEADER + (size_t)count * TRACE_RECORD + 8)
+    err = "truncated";
+  else if (get_le(&sum, 8) != fnv1a(FNV_OFFSET, buf, size - 8))
+    err = "checksum mismatch";
+  if (err) {
+    fprintf(stderr, "Trace %s: %s.\n", argv[1], err);
+    exit(EXIT_FAILURE);
+  }
+
+  trace_record_t *recs = malloc((count ? count : 1) * sizeof *recs);
+  regs_t *before = malloc((count ? count : 1) * sizeof *before);
+  if (!recs || !before) {
+    fprintf(stderr, "Out of memory decoding %s.\n", argv[1]);
+    exit(EXIT_FAILURE);
+  }
+  for (uint32_t r = 0; r < count; r++) {
+    recs[r].pc = get_le(&p, 2);
+    recs[r].opcode = get_le(&p, 2);
+    recs[r].reg = *p++;
+    recs[r].old = *p++;
+    recs[r].I = get_le(&p, 2);
+  }
+  free(buf);
+
+  // undo from the newest record back, an instruction's extra records
+  // follow it so its own record is undone last
+  const regs_t final = regs;
+  uint64_t shown = 0;
+  for (uint32_t r = count; r-- > 0;) {
+    if (!(recs[r].reg & TRACE_NONE))
+      regs.V[recs[r].reg & 0xF] = recs[r].old;
+    if (!(recs[r].reg & TRACE_MORE)) {
+      regs.I = recs[r].I;
+      shown++;
+    }
+    before[r] = regs;
+  }
+  if (shown > last)
+    shown = last;
+
+  printf("rom %016llx: %llu instructions traced, the last %llu shown\n",
+         (unsigned long long)rom_hash, (unsigned long long)instructions,
+         (unsigned long long)shown);
+  uint64_t skip = 0;
+  for (uint32_t r = 0; r < count; r++)
+    skip += !(recs[r].reg & TRACE_MORE);
+  skip -= shown;
+
+  for (uint32_t r = 0; r < count; r++) {
+    if (recs[r].reg & TRACE_MORE)
+      continue; // its instruction was overwritten in the ring
+    uint32_t next = r + 1;
+    while (next < count && (recs[next].reg & TRACE_MORE))
+      next++;
+    if (skip) {
+      skip--;
+      continue;
+    }
+    const regs_t *after = next < count ? &before[next] : &final;
+    const instruction_t ins = decode_instruction(recs[r].opcode);
+    // what print_op reads: registers, the return address and the timer
+    chip8_t c8 = {.I = before[r].I};
+    memcpy(c8.V, before[r].V, 16);
+    c8.stack[0] = next < count ? recs[next].pc : final_pc;
+    c8.SP = &c8.stack[1];
+    if ((ins.opcode & 0xF0FF) == 0xF007)
+      c8.delay_timer = after->V[ins.X];
+    print_op(stdout, &c8, recs[r].pc, ins);
+    print_changes(&before[r], after);
+  }
+  free(recs);
+  free(before);
+  return 0;
+}